@@ -0,0 +1,285 @@
+/*
+ * Batched minimum spanning forests. All graphs of a batch share one set of
+ * work arrays indexed by global vertex and edge numbers; because graphs own
+ * disjoint ranges of those arrays, worker threads can take whole graphs at a
+ * time without any locking. Each graph gets the same Boruvka steps as
+ * kktForest, then a Kruskal base case on the small contracted remainder.
+ */
+
+#include "batch_mst.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+namespace
+{
+  //Boruvka steps before the base case, as in kktForest
+  const int boruvkaSteps = 2;
+  //Graphs handed to a worker at a time
+  const int chunkSize = 64;
+}
+
+GraphBatch::GraphBatch()
+{
+  clear();
+}
+
+void GraphBatch::reserve( int numGraphs, int numEdges)
+{
+  vertexOffset.reserve( numGraphs + 1);
+  edgeOffset.reserve( numGraphs + 1);
+  edges.reserve( numEdges);
+}
+
+void GraphBatch::clear()
+{
+  vertexOffset.assign( 1, 0);
+  edgeOffset.assign( 1, 0);
+  edges.clear();
+}
+
+int GraphBatch::addGraph( int numVertices, const std::vector<int>& source, const std::vector<int>& target,
+			  const std::vector<int>& weight)
+{
+  int base = vertexOffset.back();
+  for (size_t i = 0; i < source.size(); ++i)
+  {
+    WeightedEdge edge = { base + source[i], base + target[i], weight[i], (int)i };
+    edges.push_back( edge);
+  }
+  vertexOffset.push_back( base + numVertices);
+  edgeOffset.push_back( edges.size());
+  return numGraphs() - 1;
+}
+
+int GraphBatch::addGraph( Graph& graph)
+{
+  int base = vertexOffset.back();
+  EdgeWeightMap weightMap = boost::get(boost::edge_weight_t(), graph);
+  edge_iterator edgeBegin, edgeEnd;
+  int i = 0;
+  for ( boost::tie( edgeBegin, edgeEnd) = boost::edges( graph); edgeBegin != edgeEnd; ++edgeBegin, ++i)
+  {
+    WeightedEdge edge = { base + (int)boost::source( *edgeBegin, graph), base + (int)boost::target( *edgeBegin, graph),
+			  boost::get( weightMap, *edgeBegin), i };
+    edges.push_back( edge);
+  }
+  vertexOffset.push_back( base + boost::num_vertices( graph));
+  edgeOffset.push_back( edges.size());
+  return numGraphs() - 1;
+}
+
+int GraphBatch::numGraphs() const
+{
+  return vertexOffset.size() - 1;
+}
+
+int GraphBatch::numVertices() const
+{
+  return vertexOffset.back();
+}
+
+int GraphBatch::numEdges() const
+{
+  return edges.size();
+}
+
+const std::vector<int>& GraphBatch::getVertexOffset() const
+{
+  return vertexOffset;
+}
+
+const std::vector<int>& GraphBatch::getEdgeOffset() const
+{
+  return edgeOffset;
+}
+
+const std::vector<WeightedEdge>& GraphBatch::getEdges() const
+{
+  return edges;
+}
+
+BatchMST::BatchMST( int numThreads)
+{
+  this->numThreads = numThreads < 1 ? 1 : numThreads;
+  this->batch = NULL;
+  this->generation = 0;
+  this->numBusy = 0;
+  this->stopping = false;
+  this->nextChunk = 0;
+  for (int t = 1; t < this->numThreads; ++t)
+    threads.push_back( std::thread( &BatchMST::worker, this));
+}
+
+BatchMST::~BatchMST()
+{
+  {
+    std::lock_guard<std::mutex> hold( lock);
+    stopping = true;
+  }
+  started.notify_all();
+  for (size_t t = 0; t < threads.size(); ++t)
+    threads[t].join();
+}
+
+void BatchMST::run( const GraphBatch& batch)
+{
+  this->batch = &batch;
+
+  //Work arrays only ever grow, so repeated batches reuse them
+  size_t numVertices = batch.numVertices() + 1;
+  if ( rank.size() < numVertices)
+  {
+    rank.resize( numVertices);
+    parent.resize( numVertices);
+    candidate_edges.resize( numVertices);
+    forestIds.resize( numVertices);
+  }
+  if ( scratch.size() < (size_t)batch.numEdges())
+    scratch.resize( batch.numEdges());
+  forestCount.resize( batch.numGraphs());
+  weights.resize( batch.numGraphs());
+  forestStart.assign( batch.getVertexOffset().begin(), batch.getVertexOffset().end());
+
+  nextChunk = 0;
+  {
+    std::lock_guard<std::mutex> hold( lock);
+    ++generation;
+    numBusy = threads.size();
+  }
+  started.notify_all();
+  solveChunks();
+  std::unique_lock<std::mutex> hold( lock);
+  while ( numBusy > 0)
+    done.wait( hold);
+  this->batch = NULL;
+}
+
+void BatchMST::worker()
+{
+  int seen = 0;
+  while ( true)
+  {
+    {
+      std::unique_lock<std::mutex> hold( lock);
+      while ( generation == seen && !stopping)
+	started.wait( hold);
+      if ( stopping)
+	return;
+      seen = generation;
+    }
+    solveChunks();
+    {
+      std::lock_guard<std::mutex> hold( lock);
+      if ( --numBusy == 0)
+	done.notify_all();
+    }
+  }
+}
+
+//Takes chunks of graphs until the batch runs out
+void BatchMST::solveChunks()
+{
+  int numGraphs = batch->numGraphs();
+  for (int first = nextChunk.fetch_add( chunkSize); first < numGraphs; first = nextChunk.fetch_add( chunkSize))
+  {
+    int last = std::min( numGraphs, first + chunkSize);
+    for (int g = first; g < last; ++g)
+      solveSegment(g);
+  }
+}
+
+void BatchMST::solveSegment( int graph)
+{
+  const int infinity = (std::numeric_limits<int>::max)();
+  const WeightedEdge noEdge = { -1, -1, infinity, infinity };
+  int vertexBegin = batch->getVertexOffset()[graph], vertexEnd = batch->getVertexOffset()[graph + 1];
+  int edgeBegin = batch->getEdgeOffset()[graph], edgeEnd = batch->getEdgeOffset()[graph + 1];
+
+  boost::disjoint_sets< vertices_size_type*, vertex_descriptor*> supervertices( &rank[0], &parent[0]);
+  for (int v = vertexBegin; v < vertexEnd; ++v)
+    supervertices.make_set(v);
+
+  //Self loops can never be in the forest
+  WeightedEdge* edges = scratch.data() + edgeBegin;
+  const WeightedEdge* input = batch->getEdges().data();
+  int numEdges = 0;
+  for (int i = edgeBegin; i < edgeEnd; ++i)
+  {
+    if ( input[i].source != input[i].target)
+      edges[numEdges++] = input[i];
+  }
+
+  int* forest = forestIds.data() + vertexBegin;
+  int found = 0;
+  long total = 0;
+
+  for (int step = 0; step < boruvkaSteps && numEdges > 0; ++step)
+  {
+    for (int v = vertexBegin; v < vertexEnd; ++v)
+      candidate_edges[v] = noEdge;
+    for (int i = 0; i < numEdges; ++i)
+    {
+      candidate_edges[edges[i].source] = findMinWeightEdge( candidate_edges[edges[i].source], edges[i]);
+      candidate_edges[edges[i].target] = findMinWeightEdge( candidate_edges[edges[i].target], edges[i]);
+    }
+    for (int v = vertexBegin; v < vertexEnd; ++v)
+    {
+      if ( candidate_edges[v].source == -1)
+	continue;
+      vertex_descriptor a = supervertices.find_set( candidate_edges[v].source);
+      vertex_descriptor b = supervertices.find_set( candidate_edges[v].target);
+      if ( a != b)
+      {
+	supervertices.link(a, b);
+	forest[found++] = candidate_edges[v].id;
+	total += candidate_edges[v].weight;
+      }
+    }
+
+    //Contract in place, dropping the edges that became self loops
+    int kept = 0;
+    for (int i = 0; i < numEdges; ++i)
+    {
+      WeightedEdge edge = edges[i];
+      edge.source = supervertices.find_set( edge.source);
+      edge.target = supervertices.find_set( edge.target);
+      if ( edge.source != edge.target)
+	edges[kept++] = edge;
+    }
+    numEdges = kept;
+  }
+
+  //Base case: Kruskal on the contracted remainder
+  std::sort( edges, edges + numEdges, compareByWeight);
+  for (int i = 0; i < numEdges; ++i)
+  {
+    vertex_descriptor a = supervertices.find_set( edges[i].source);
+    vertex_descriptor b = supervertices.find_set( edges[i].target);
+    if ( a != b)
+    {
+      supervertices.link(a, b);
+      forest[found++] = edges[i].id;
+      total += edges[i].weight;
+    }
+  }
+
+  forestCount[graph] = found;
+  weights[graph] = total;
+}
+
+int BatchMST::forestSize( int graph) const
+{
+  return forestCount[graph];
+}
+
+const int* BatchMST::forest( int graph) const
+{
+  return forestIds.data() + forestStart[graph];
+}
+
+long BatchMST::forestWeight( int graph) const
+{
+  return weights[graph];
+}
@@ -0,0 +1,89 @@
+//Batch MST hpp
+//Minimum spanning forests for many small graphs packed into one edge array.
+
+#ifndef BATCH_MST_H
+#define BATCH_MST_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "boruvka_tree/BoruvkaTree.hpp"
+#include "weighted_edge.hpp"
+
+//Many graphs stored back to back. Graph g owns vertices
+//vertexOffset[g] .. vertexOffset[g+1]-1 and edges edgeOffset[g] .. edgeOffset[g+1]-1;
+//edges are kept with these global vertex numbers.
+class GraphBatch
+{
+  public:
+    GraphBatch();
+
+    void reserve( int numGraphs, int numEdges);
+    void clear();
+    //Both return the index of the new graph
+    int addGraph( int numVertices, const std::vector<int>& source, const std::vector<int>& target,
+		  const std::vector<int>& weight);
+    int addGraph( Graph& graph);
+
+    int numGraphs() const;
+    int numVertices() const;
+    int numEdges() const;
+    const std::vector<int>& getVertexOffset() const;
+    const std::vector<int>& getEdgeOffset() const;
+    const std::vector<WeightedEdge>& getEdges() const;
+
+  private:
+    std::vector<int> vertexOffset, edgeOffset;
+    std::vector<WeightedEdge> edges;
+};
+
+//The worker threads are started once, by the constructor, and wait between
+//runs; the calling thread of run() works alongside them.
+class BatchMST
+{
+  public:
+    BatchMST( int numThreads = 1);
+    ~BatchMST();
+
+    //Computes the minimum spanning forest of every graph in the batch. The
+    //work arrays are sized for the whole batch and kept between runs, so
+    //nothing is allocated per graph.
+    void run( const GraphBatch& batch);
+
+    //Forest edges of a graph, as indices into that graph's own edge list.
+    //They stay valid until the next run, even once the batch is gone.
+    int forestSize( int graph) const;
+    const int* forest( int graph) const;
+    long forestWeight( int graph) const;
+
+  private:
+    int numThreads;
+    const GraphBatch* batch;             //only set while run() is working on it
+    std::vector<vertices_size_type> rank;
+    std::vector<vertex_descriptor> parent;
+    std::vector<WeightedEdge> candidate_edges;
+    std::vector<WeightedEdge> scratch;   //contracted copy of every segment
+    std::vector<int> forestIds;          //graph g's forest starts at forestStart[g]
+    std::vector<int> forestStart;        //the last batch's vertex offsets
+    std::vector<int> forestCount;
+    std::vector<long> weights;
+
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable started, done;
+    int generation;   //runs started so far
+    int numBusy;      //pool threads still working on the current run
+    bool stopping;
+    std::atomic<int> nextChunk;
+
+    BatchMST( const BatchMST&);
+    BatchMST& operator=( const BatchMST&);
+
+    void worker();
+    void solveChunks();
+    void solveSegment( int graph);
+};
+#endif
@@ -0,0 +1,188 @@
+/*
+ * Single-linkage clustering from MST edges. Merging the MST edges in weight
+ * order gives the single-linkage dendrogram, so building it is one sort plus
+ * a pass of union-find. The leaves of every dendrogram node are kept
+ * contiguous in leafOrder, which lets any cut of the dendrogram be labeled
+ * in one pass over the nodes.
+ */
+
+#include "clustering.hpp"
+
+#include <algorithm>
+
+namespace
+{
+  struct ByWeight
+  {
+    const std::vector<int>* weight;
+    bool operator()( int a, int b) const { return (*weight)[a] < (*weight)[b]; }
+  };
+}
+
+SingleLinkage::SingleLinkage( Graph& mst)
+{
+  std::vector<int> source, target, weight;
+  EdgeWeightMap weightMap = boost::get(boost::edge_weight_t(), mst);
+  edge_iterator edgeBegin, edgeEnd;
+
+  for ( boost::tie( edgeBegin, edgeEnd) = boost::edges( mst); edgeBegin != edgeEnd; ++edgeBegin)
+  {
+    source.push_back( boost::source( *edgeBegin, mst));
+    target.push_back( boost::target( *edgeBegin, mst));
+    weight.push_back( boost::get( weightMap, *edgeBegin));
+  }
+  this->n = boost::num_vertices( mst);
+  build( source, target, weight);
+}
+
+SingleLinkage::SingleLinkage( int numVertices, const std::vector<int>& source, const std::vector<int>& target,
+			      const std::vector<int>& weight)
+{
+  this->n = numVertices;
+  build( source, target, weight);
+}
+
+void SingleLinkage::build( const std::vector<int>& source, const std::vector<int>& target, const std::vector<int>& weight)
+{
+  std::vector<int> order( source.size());
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  ByWeight byWeight = { &weight };
+  std::stable_sort( order.begin(), order.end(), byWeight);
+
+  std::vector<vertices_size_type> rank(n + 1);
+  std::vector<vertex_descriptor> ufParent(n + 1);
+  boost::disjoint_sets< vertices_size_type*, vertex_descriptor*> dset( &rank[0], &ufParent[0]);
+  std::vector<int> topNode(n);
+  for (int v = 0; v < n; ++v)
+  {
+    dset.make_set(v);
+    topNode[v] = v;
+  }
+
+  parent = std::vector<int>(n, -1);
+  for (size_t i = 0; i < order.size(); ++i)
+  {
+    int e = order[i];
+    vertex_descriptor a = dset.find_set( source[e]);
+    vertex_descriptor b = dset.find_set( target[e]);
+    if ( a == b)
+      continue; //not a forest edge
+
+    int node = n + left.size();
+    int l = topNode[a], r = topNode[b];
+    left.push_back(l);
+    right.push_back(r);
+    heights.push_back( weight[e]);
+    mergeEdges.push_back(e);
+    sizes.push_back( (l < n ? 1 : sizes[l - n]) + (r < n ? 1 : sizes[r - n]));
+    parent[l] = node;
+    parent[r] = node;
+    parent.push_back(-1);
+
+    dset.link(a, b);
+    topNode[dset.find_set(a)] = node;
+  }
+
+  //Lay the roots out one after another, then split every merge's range
+  //between its children. Parents always have larger ids than children.
+  int total = parent.size();
+  begin = std::vector<int>(total, 0);
+  int position = 0;
+  for (int x = 0; x < total; ++x)
+  {
+    if ( parent[x] == -1)
+    {
+      begin[x] = position;
+      position += x < n ? 1 : sizes[x - n];
+    }
+  }
+  for (int i = (int)left.size() - 1; i >= 0; --i)
+  {
+    begin[left[i]] = begin[n + i];
+    begin[right[i]] = begin[n + i] + (left[i] < n ? 1 : sizes[left[i] - n]);
+  }
+  leafOrder = std::vector<int>(n);
+  for (int v = 0; v < n; ++v)
+    leafOrder[begin[v]] = v;
+}
+
+const std::vector<int>& SingleLinkage::getLeft() const
+{
+  return left;
+}
+
+const std::vector<int>& SingleLinkage::getRight() const
+{
+  return right;
+}
+
+const std::vector<int>& SingleLinkage::getHeights() const
+{
+  return heights;
+}
+
+const std::vector<int>& SingleLinkage::getSizes() const
+{
+  return sizes;
+}
+
+const std::vector<int>& SingleLinkage::getMergeEdges() const
+{
+  return mergeEdges;
+}
+
+int SingleLinkage::numVertices() const
+{
+  return n;
+}
+
+int SingleLinkage::numMerges() const
+{
+  return left.size();
+}
+
+int SingleLinkage::numComponents() const
+{
+  return n - left.size();
+}
+
+int SingleLinkage::clustersAtThreshold( int threshold, std::vector<int>& labels) const
+{
+  //heights are non-decreasing, so the merges at or below threshold are a prefix
+  int kept = std::upper_bound( heights.begin(), heights.end(), threshold) - heights.begin();
+  return label( kept, labels);
+}
+
+int SingleLinkage::clusters( int k, std::vector<int>& labels) const
+{
+  //Undoing the last j merges leaves numComponents() + j clusters
+  int undo = k - numComponents();
+  if ( undo < 0) undo = 0;
+  if ( undo > numMerges()) undo = numMerges();
+  return label( numMerges() - undo, labels);
+}
+
+/**
+ * Labels the clustering made of the first keptMerges merges. A cluster is a
+ * kept node whose parent is missing or was not kept.
+ */
+int SingleLinkage::label( int keptMerges, std::vector<int>& labels) const
+{
+  labels.assign( n, -1);
+  int numClusters = 0;
+  int total = parent.size();
+  for (int x = 0; x < total; ++x)
+  {
+    if ( x >= n && x - n >= keptMerges)
+      continue;
+    if ( parent[x] != -1 && parent[x] - n < keptMerges)
+      continue;
+
+    int size = x < n ? 1 : sizes[x - n];
+    for (int p = begin[x]; p < begin[x] + size; ++p)
+      labels[leafOrder[p]] = numClusters;
+    ++numClusters;
+  }
+  return numClusters;
+}
@@ -0,0 +1,48 @@
+//Clustering hpp
+//Single-linkage dendrogram built from a minimum spanning tree or forest.
+
+#ifndef CLUSTERING_H
+#define CLUSTERING_H
+
+#include <vector>
+
+#include "boruvka_tree/BoruvkaTree.hpp"
+
+class SingleLinkage{
+
+  public:
+    //mst holds the MST (or spanning forest) edges, e.g. the output of kktMST
+    SingleLinkage( Graph& mst);
+    SingleLinkage( int numVertices, const std::vector<int>& source, const std::vector<int>& target,
+		   const std::vector<int>& weight);
+
+    //Merge i joins nodes getLeft()[i] and getRight()[i] at height getHeights()[i]
+    //into node numVertices + i. Leaves are the vertices 0 .. numVertices - 1.
+    const std::vector<int>& getLeft() const;
+    const std::vector<int>& getRight() const;
+    const std::vector<int>& getHeights() const;
+    const std::vector<int>& getSizes() const;
+    //Input position of the MST edge behind every merge, in the order of the
+    //source/target/weight lists or of boost::edges( mst)
+    const std::vector<int>& getMergeEdges() const;
+
+    int numVertices() const;
+    int numMerges() const;
+    int numComponents() const;
+
+    //Fills labels with a cluster id per vertex and returns the number of clusters
+    int clustersAtThreshold( int threshold, std::vector<int>& labels) const;
+    //Same, for the coarsest clustering with at least k clusters
+    int clusters( int k, std::vector<int>& labels) const;
+
+  private:
+    int n;
+    std::vector<int> left, right, heights, sizes, mergeEdges;
+    std::vector<int> parent;   //parent of every dendrogram node, -1 for a root
+    std::vector<int> begin;    //first position of every node's leaves in leafOrder
+    std::vector<int> leafOrder;
+
+    void build( const std::vector<int>& source, const std::vector<int>& target, const std::vector<int>& weight);
+    int label( int keptMerges, std::vector<int>& labels) const;
+};
+#endif
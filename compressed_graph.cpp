@@ -0,0 +1,302 @@
+/*
+ * Compressed adjacency storage. Every vertex keeps its neighbors sorted so
+ * they can be stored as varint encoded gaps; weights and edge ids are packed
+ * in separate fixed width streams so a scan only touches the bytes it needs.
+ * Graphs are encoded list by list through a Builder, so building one never
+ * holds more than a single list uncompressed.
+ */
+
+#include "compressed_graph.hpp"
+
+#include <algorithm>
+
+namespace
+{
+  int bytesFor( unsigned int value)
+  {
+    if ( value < (1u << 8)) return 1;
+    if ( value < (1u << 16)) return 2;
+    if ( value < (1u << 24)) return 3;
+    return 4;
+  }
+
+  void putVarint( std::vector<unsigned char>& out, unsigned int value)
+  {
+    while ( value >= 0x80)
+    {
+      out.push_back( (unsigned char)(value | 0x80));
+      value >>= 7;
+    }
+    out.push_back( (unsigned char)value);
+  }
+
+  unsigned int getVarint( const unsigned char* bytes, size_t& pos)
+  {
+    unsigned int value = 0;
+    int shift = 0;
+    unsigned char byte;
+    do
+    {
+      byte = bytes[pos++];
+      value |= (unsigned int)(byte & 0x7f) << shift;
+      shift += 7;
+    } while ( byte & 0x80);
+    return value;
+  }
+
+  void putFixed( std::vector<unsigned char>& out, unsigned int value, int width)
+  {
+    for ( int i = 0; i < width; ++i)
+      out.push_back( (unsigned char)(value >> (8*i)));
+  }
+
+  unsigned int getFixed( const unsigned char* bytes, int width)
+  {
+    unsigned int value = 0;
+    for ( int i = 0; i < width; ++i)
+      value |= (unsigned int)bytes[i] << (8*i);
+    return value;
+  }
+}
+
+CompressedGraph::CompressedGraph()
+{
+  this->vertexCount = 0;
+  this->edgeCount = 0;
+  this->minWeight = 0;
+  this->weightBytes = 1;
+  this->idBytes = 1;
+  this->entryOffset = std::vector<size_t>(1, 0);
+  this->targetOffset = std::vector<size_t>(1, 0);
+}
+
+/**
+ * Two passes over the edges: one for the weight range the builder needs, one
+ * per vertex to encode its list. Lists are sorted by target, then weight, so
+ * a vertex meets its lower neighbors in the order its entries appear in their
+ * lists, and nextId hands it the ids they were given there.
+ */
+CompressedGraph::CompressedGraph( Graph& graph)
+{
+  int numVertices = boost::num_vertices( graph);
+  EdgeWeightMap weightMap = boost::get(boost::edge_weight_t(), graph);
+  edge_iterator edgeBegin, edgeEnd;
+  int minWeight = 0, maxWeight = 0;
+  size_t numEntries = 0;
+  for ( boost::tie( edgeBegin, edgeEnd) = boost::edges( graph); edgeBegin != edgeEnd; ++edgeBegin)
+  {
+    if ( boost::source( *edgeBegin, graph) == boost::target( *edgeBegin, graph))
+      continue; //self loops can never be in a spanning forest
+    int weight = boost::get( weightMap, *edgeBegin);
+    if ( numEntries == 0 || weight < minWeight) minWeight = weight;
+    if ( numEntries == 0 || weight > maxWeight) maxWeight = weight;
+    numEntries += 2;
+  }
+
+  Builder builder( numVertices, minWeight, maxWeight, numEntries > 0 ? (int)numEntries - 1 : 0);
+  std::vector<int> nextId( numVertices);
+  std::vector<WeightedEdge> list;
+  boost::graph_traits<Graph>::out_edge_iterator outBegin, outEnd;
+  for ( int v = 0; v < numVertices; ++v)
+  {
+    list.clear();
+    for ( boost::tie( outBegin, outEnd) = boost::out_edges( v, graph); outBegin != outEnd; ++outBegin)
+    {
+      int target = boost::target( *outBegin, graph);
+      if ( target == v) continue;
+      WeightedEdge edge = { v, target, boost::get( weightMap, *outBegin), 0 };
+      list.push_back( edge);
+    }
+    std::sort( list.begin(), list.end(), compareByEndpoints);
+
+    int first = (int)builder.numEntries();
+    nextId[v] = first;
+    for ( size_t i = 0; i < list.size(); ++i)
+    {
+      if ( list[i].target < v)
+      {
+	list[i].id = nextId[list[i].target]++;
+	++nextId[v];
+      }
+      else
+	list[i].id = first + (int)i;
+    }
+    builder.addList( list);
+  }
+  *this = builder.finish();
+}
+
+CompressedGraph::Builder::Builder( int numVertices, int minWeight, int maxWeight, int maxId)
+{
+  graph.vertexCount = numVertices;
+  graph.minWeight = minWeight;
+  //Offsets from minWeight are taken in unsigned arithmetic, since weights
+  //spanning more than INT_MAX would overflow an int difference
+  graph.weightBytes = bytesFor( (unsigned int)maxWeight - (unsigned int)minWeight);
+  graph.idBytes = bytesFor( (unsigned int)maxId);
+  graph.entryOffset.assign( numVertices + 1, 0);
+  graph.targetOffset.assign( numVertices + 1, 0);
+  nextVertex = 0;
+}
+
+CompressedGraph::Builder::Builder( int numVertices, const CompressedGraph& graph)
+{
+  this->graph.vertexCount = numVertices;
+  this->graph.minWeight = graph.minWeight;
+  this->graph.weightBytes = graph.weightBytes;
+  this->graph.idBytes = graph.idBytes;
+  this->graph.entryOffset.assign( numVertices + 1, 0);
+  this->graph.targetOffset.assign( numVertices + 1, 0);
+  nextVertex = 0;
+}
+
+void CompressedGraph::Builder::addList( std::vector<WeightedEdge>& list)
+{
+  std::sort( list.begin(), list.end(), compareByEndpoints);
+  graph.entryOffset[nextVertex] = numEntries();
+  graph.targetOffset[nextVertex] = graph.targets.size();
+  int previous = 0;
+  for ( size_t i = 0; i < list.size(); ++i)
+  {
+    putVarint( graph.targets, (unsigned int)(list[i].target - previous));
+    previous = list[i].target;
+    putFixed( graph.weights, (unsigned int)list[i].weight - (unsigned int)graph.minWeight, graph.weightBytes);
+    putFixed( graph.ids, (unsigned int)list[i].id, graph.idBytes);
+  }
+  ++nextVertex;
+}
+
+size_t CompressedGraph::Builder::numEntries() const
+{
+  return graph.ids.size() / graph.idBytes;
+}
+
+CompressedGraph CompressedGraph::Builder::finish()
+{
+  for ( ; nextVertex <= graph.vertexCount; ++nextVertex)
+  {
+    graph.entryOffset[nextVertex] = numEntries();
+    graph.targetOffset[nextVertex] = graph.targets.size();
+  }
+  graph.edgeCount = numEntries() / 2;
+  //The streams grew by doubling; trim them to what they hold
+  std::vector<unsigned char>( graph.targets).swap( graph.targets);
+  std::vector<unsigned char>( graph.weights).swap( graph.weights);
+  std::vector<unsigned char>( graph.ids).swap( graph.ids);
+  CompressedGraph result;
+  std::swap( result, graph);
+  return result;
+}
+
+int CompressedGraph::numVertices() const
+{
+  return this->vertexCount;
+}
+
+size_t CompressedGraph::numEdges() const
+{
+  return this->edgeCount;
+}
+
+int CompressedGraph::degree( int vertex) const
+{
+  return (int)(this->entryOffset[vertex + 1] - this->entryOffset[vertex]);
+}
+
+size_t CompressedGraph::memoryBytes() const
+{
+  return this->targets.capacity() + this->weights.capacity() + this->ids.capacity()
+    + (this->entryOffset.capacity() + this->targetOffset.capacity()) * sizeof(size_t);
+}
+
+CompressedGraph::NeighborCursor CompressedGraph::neighbors( int vertex) const
+{
+  return NeighborCursor( *this, vertex);
+}
+
+/**
+ * Expands the compressed graph back into a boost adjacency list, adding every
+ * undirected edge once from its lower numbered endpoint.
+ */
+Graph CompressedGraph::toGraph() const
+{
+  Graph graph( this->vertexCount);
+  WeightedEdge edge;
+  for ( int v = 0; v < this->vertexCount; ++v)
+  {
+    NeighborCursor cursor( *this, v);
+    while ( cursor.next( edge))
+    {
+      if ( edge.source < edge.target)
+	boost::add_edge( edge.source, edge.target, edge_weight( edge.weight), graph);
+    }
+  }
+  return graph;
+}
+
+EdgeList CompressedGraph::edgeList() const
+{
+  EdgeList edges;
+  edges.reserve( this->edgeCount);
+  WeightedEdge edge;
+  for ( int v = 0; v < this->vertexCount; ++v)
+  {
+    NeighborCursor cursor( *this, v);
+    while ( cursor.next( edge))
+    {
+      if ( edge.source < edge.target)
+	edges.push_back( edge);
+    }
+  }
+  return edges;
+}
+
+CompressedGraph::NeighborCursor::NeighborCursor( const CompressedGraph& graph, int vertex)
+{
+  this->graph = &graph;
+  this->vertex = vertex;
+  this->targetPos = graph.targetOffset[vertex];
+  this->entry = graph.entryOffset[vertex];
+  this->entryEnd = graph.entryOffset[vertex + 1];
+  this->previous = 0;
+  this->buffered = 0;
+  this->position = 0;
+}
+
+bool CompressedGraph::NeighborCursor::next( WeightedEdge& edge)
+{
+  if ( position == buffered)
+  {
+    if ( entry == entryEnd) return false;
+    decodeBlock();
+  }
+  edge.source = vertex;
+  edge.target = blockTarget[position];
+  edge.weight = blockWeight[position];
+  edge.id = blockId[position];
+  ++position;
+  return true;
+}
+
+/**
+ * Decodes the next blockSize entries of the list into the cursor's buffers.
+ */
+void CompressedGraph::NeighborCursor::decodeBlock()
+{
+  size_t count = entryEnd - entry;
+  if ( count > (size_t)blockSize) count = blockSize;
+
+  const unsigned char* targetBytes = &graph->targets[0];
+  const unsigned char* weightBytes = &graph->weights[entry * graph->weightBytes];
+  const unsigned char* idBytes = &graph->ids[entry * graph->idBytes];
+  for ( size_t i = 0; i < count; ++i)
+  {
+    previous += (int)getVarint( targetBytes, targetPos);
+    blockTarget[i] = previous;
+    blockWeight[i] = (int)((unsigned int)graph->minWeight + getFixed( weightBytes + i*graph->weightBytes, graph->weightBytes));
+    blockId[i] = (int)getFixed( idBytes + i*graph->idBytes, graph->idBytes);
+  }
+  entry += count;
+  buffered = (int)count;
+  position = 0;
+}
@@ -0,0 +1,97 @@
+//Compressed graph hpp
+//Adjacency storage with sorted, delta + varint encoded neighbor lists.
+
+#ifndef COMPRESSED_GRAPH_H
+#define COMPRESSED_GRAPH_H
+
+#include <cstddef>
+#include <vector>
+
+#include "boruvka_tree/BoruvkaTree.hpp"
+#include "weighted_edge.hpp"
+
+class CompressedGraph
+{
+  public:
+    //Number of neighbors a NeighborCursor decodes at a time
+    static const int blockSize = 64;
+
+    //Decodes one neighbor list block by block without materializing it
+    class NeighborCursor
+    {
+      public:
+        NeighborCursor( const CompressedGraph& graph, int vertex);
+
+        //Returns false once the list is exhausted
+        bool next( WeightedEdge& edge);
+
+      private:
+        const CompressedGraph* graph;
+        int vertex;
+        size_t targetPos;
+        size_t entry;
+        size_t entryEnd;
+        int previous;
+        int buffered;
+        int position;
+        int blockTarget[blockSize];
+        int blockWeight[blockSize];
+        int blockId[blockSize];
+
+        void decodeBlock();
+    };
+
+    //Encodes a graph list by list, see below
+    class Builder;
+
+    CompressedGraph();
+    //Every edge's id is the position of its entry in its lower endpoint's list
+    CompressedGraph( Graph& graph);
+
+    int numVertices() const;
+    size_t numEdges() const; //undirected edges, each stored in both endpoint lists
+    int degree( int vertex) const;
+    size_t memoryBytes() const;
+
+    NeighborCursor neighbors( int vertex) const;
+    Graph toGraph() const;
+    //Every undirected edge once, from its lower numbered endpoint
+    EdgeList edgeList() const;
+
+  private:
+    int vertexCount;
+    size_t edgeCount;
+    int minWeight;
+    int weightBytes;
+    int idBytes;
+    std::vector<size_t> entryOffset;  //first list entry of every vertex
+    std::vector<size_t> targetOffset; //first byte of every vertex's encoded targets
+    std::vector<unsigned char> targets; //delta + varint encoded, sorted per vertex
+    std::vector<unsigned char> weights; //(weight - minWeight) packed in weightBytes
+    std::vector<unsigned char> ids;     //edge ids packed in idBytes
+};
+
+//Encodes a graph one neighbor list at a time, in vertex order, so only
+//the list being added is ever held uncompressed
+class CompressedGraph::Builder
+{
+  public:
+    //Weights must lie in [minWeight, maxWeight] and ids in [0, maxId]
+    Builder( int numVertices, int minWeight, int maxWeight, int maxId);
+    //Same weight and id ranges as graph, for graphs made from its edges
+    Builder( int numVertices, const CompressedGraph& graph);
+
+    //Appends the list of the next vertex, sorting it by target first.
+    //Every undirected edge has to be added from both of its endpoints.
+    void addList( std::vector<WeightedEdge>& list);
+    //Entries added so far
+    size_t numEntries() const;
+    //Vertices not reached yet get empty lists
+    CompressedGraph finish();
+
+  private:
+    CompressedGraph graph;
+    int nextVertex;
+};
+
+#endif
@@ -0,0 +1,573 @@
+/*
+ * Distributed KKT. Every worker loads its own partition of the edge list,
+ * so the coordinator never holds the input. By the cycle property an edge
+ * that is not in the minimum spanning forest of some subset of the edges
+ * can't be in the forest of the whole graph, so forest(A u B) is contained in
+ * forest(A) u forest(B). Every worker first reduces its partition to its
+ * forest with kktMST; then, round after round, pairs of workers merge: one
+ * sends its forest over, the other runs kktForest on the union of the two
+ * and keeps the result. After about log2(workers) rounds one worker holds the
+ * forest of the whole graph. No forest ever has more than numVertices - 1
+ * edges, so a merge handles at most two of them, and the coordinator, which
+ * relays every forest, holds only one at a time.
+ * Messages from the other side are checked before they are used: a frame
+ * can't be longer than the transport allows and no count can reach past
+ * the end of its message.
+ */
+
+#include "distributed_mst.hpp"
+#include "kkt_test.hpp"
+#include "pipelined_loader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+  //Local workers started by spawnLocalWorkers, and the coordinator's ends of their sockets
+  std::vector<pid_t> localPids;
+  std::vector<int> localFds;
+
+  //MSG_NOSIGNAL: a peer that hung up makes the write fail instead of raising SIGPIPE
+  bool writeAll( int fd, const char* data, size_t bytes)
+  {
+    while ( bytes > 0)
+    {
+      ssize_t written = ::send( fd, data, bytes, MSG_NOSIGNAL);
+      if ( written <= 0) return false;
+      data += written;
+      bytes -= written;
+    }
+    return true;
+  }
+
+  bool readAll( int fd, char* data, size_t bytes)
+  {
+    while ( bytes > 0)
+    {
+      ssize_t got = ::read( fd, data, bytes);
+      if ( got <= 0) return false;
+      data += got;
+      bytes -= got;
+    }
+    return true;
+  }
+
+  //Reads a message front to back; every read fails instead of running off its end
+  class MessageReader
+  {
+    public:
+      MessageReader( const std::vector<int>& message) : message( message), pos( 0) {}
+
+      bool read( int& value)
+      {
+	if ( pos >= message.size()) return false;
+	value = message[pos++];
+	return true;
+      }
+
+      //A count of items intsEach ints long that must all fit in the rest of the message
+      bool readCount( int& count, size_t intsEach)
+      {
+	return read( count) && count >= 0 && (size_t)count*intsEach <= message.size() - pos;
+      }
+
+      bool readLong( long long& value)
+      {
+	int high, low;
+	if ( !read( high) || !read( low)) return false;
+	value = (long long)(((unsigned long long)(unsigned int)high << 32) | (unsigned int)low);
+	return true;
+      }
+
+      //A length followed by one char per int
+      bool readString( std::string& value)
+      {
+	int length;
+	if ( !readCount( length, 1)) return false;
+	value.assign( message.begin() + pos, message.begin() + pos + length);
+	pos += length;
+	return true;
+      }
+
+      bool done() const { return pos == message.size(); }
+
+    private:
+      const std::vector<int>& message;
+      size_t pos;
+  };
+
+  void appendLong( std::vector<int>& message, long long value)
+  {
+    message.push_back( (int)((unsigned long long)value >> 32));
+    message.push_back( (int)(unsigned int)value);
+  }
+
+  size_t totalBytes( std::vector<Transport*>& workers)
+  {
+    size_t bytes = 0;
+    for (size_t w = 0; w < workers.size(); ++w)
+      bytes += workers[w]->getBytesSent() + workers[w]->getBytesReceived();
+    return bytes;
+  }
+
+  //Commands a worker takes once its partition is filtered
+  const int sendForest = 1;   //reply with the forest and stop
+  const int mergeForest = 2;  //a forest message follows; merge it in and report
+
+  //A forest message is numVertices, numEdges and (source, target, weight) triples
+  void appendForest( std::vector<int>& message, int numVertices, const EdgeList& forest)
+  {
+    message.reserve( message.size() + 2 + 3*forest.size());
+    message.push_back( numVertices);
+    message.push_back( forest.size());
+    for (size_t i = 0; i < forest.size(); ++i)
+    {
+      message.push_back( forest[i].source);
+      message.push_back( forest[i].target);
+      message.push_back( forest[i].weight);
+    }
+  }
+
+  /**
+   * Checks that a forest message is all there and every vertex is in range,
+   * then appends its edges to edges unless that is NULL. Edges are numbered
+   * by their position in edges.
+   */
+  bool readForest( const std::vector<int>& message, int& numVertices, EdgeList* edges)
+  {
+    MessageReader reader( message);
+    int numEdges;
+    if ( !reader.read( numVertices) || numVertices < 0 || !reader.readCount( numEdges, 3))
+      return false;
+    if ( edges != NULL)
+      edges->reserve( edges->size() + numEdges);
+    for (int i = 0; i < numEdges; ++i)
+    {
+      WeightedEdge edge;
+      reader.read( edge.source);
+      reader.read( edge.target);
+      reader.read( edge.weight);
+      if ( edge.source < 0 || edge.source >= numVertices || edge.target < 0 || edge.target >= numVertices)
+	return false;
+      if ( edges != NULL)
+      {
+	edge.id = edges->size();
+	edges->push_back( edge);
+      }
+    }
+    return reader.done();
+  }
+
+  /**
+   * A worker reports numVertices and the size of its forest after loading and
+   * after every merge, or just -1 if it couldn't read its partition or was
+   * sent a malformed forest.
+   */
+  bool receiveStatus( Transport& worker, int w, const std::vector<EdgePartition>& partitions, int& numVertices,
+		      int& forestSize)
+  {
+    std::vector<int> status;
+    if ( !worker.receive( status))
+    {
+      std::cerr << "Lost the connection to worker " << w << std::endl;
+      return false;
+    }
+    if ( status.size() == 1 && status[0] == -1)
+    {
+      std::cerr << "Worker " << w << " could not read its partition of " << partitions[w].path
+		<< " or the forest it was sent" << std::endl;
+      return false;
+    }
+    if ( status.size() != 2 || status[0] < 0 || status[1] < 0)
+    {
+      std::cerr << "Worker " << w << " sent a malformed reply" << std::endl;
+      return false;
+    }
+    numVertices = status[0];
+    forestSize = status[1];
+    return true;
+  }
+
+  //Asks worker w for its forest, which ends its run, and checks the reply
+  bool takeForest( Transport& worker, int w, std::vector<int>& message)
+  {
+    int numVertices;
+    if ( !worker.send( std::vector<int>( 1, sendForest)) || !worker.receive( message))
+    {
+      std::cerr << "Lost the connection to worker " << w << std::endl;
+      return false;
+    }
+    if ( !readForest( message, numVertices, NULL))
+    {
+      std::cerr << "Worker " << w << " sent a malformed forest" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  //Replaces forest by the minimum spanning forest of forest and the edges of message
+  bool mergeInto( const std::vector<int>& message, int& numVertices, EdgeList& forest)
+  {
+    int otherVertices;
+    if ( !readForest( message, otherVertices, &forest))
+      return false;
+    numVertices = std::max( numVertices, otherVertices);
+
+    EdgeList input = forest; //kktForest consumes its edge list
+    std::vector<int> forestIds;
+    kktForest( numVertices, forest, forestIds);
+    EdgeList().swap( forest);
+    forest.reserve( forestIds.size());
+    for (size_t i = 0; i < forestIds.size(); ++i)
+    {
+      forest.push_back( input[forestIds[i]]);
+      forest.back().id = i;
+    }
+    return true;
+  }
+}
+
+Transport::Transport()
+{
+  this->bytesSent = 0;
+  this->bytesReceived = 0;
+}
+
+Transport::~Transport()
+{
+}
+
+size_t Transport::getBytesSent() const
+{
+  return this->bytesSent;
+}
+
+size_t Transport::getBytesReceived() const
+{
+  return this->bytesReceived;
+}
+
+SocketTransport::SocketTransport( int fd, size_t maxMessageInts)
+{
+  this->fd = fd;
+  this->maxMessageInts = maxMessageInts;
+}
+
+SocketTransport::~SocketTransport()
+{
+  ::close( this->fd);
+}
+
+/**
+ * Messages are framed by their length in ints, sent ahead of the payload.
+ */
+bool SocketTransport::send( const std::vector<int>& message)
+{
+  unsigned long long length = message.size();
+  if ( !writeAll( fd, (const char*)&length, sizeof(length)))
+    return false;
+  if ( length > 0 && !writeAll( fd, (const char*)&message[0], length*sizeof(int)))
+    return false;
+  bytesSent += sizeof(length) + length*sizeof(int);
+  return true;
+}
+
+bool SocketTransport::receive( std::vector<int>& message)
+{
+  unsigned long long length;
+  if ( !readAll( fd, (char*)&length, sizeof(length)) || length > maxMessageInts)
+    return false;
+  message.resize( length);
+  if ( length > 0 && !readAll( fd, (char*)&message[0], length*sizeof(int)))
+    return false;
+  bytesReceived += sizeof(length) + length*sizeof(int);
+  return true;
+}
+
+SocketTransport* SocketTransport::connectTcp( const std::string& host, int port)
+{
+  struct addrinfo hints, *addresses;
+  std::memset( &hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  std::ostringstream service;
+  service << port;
+  if ( getaddrinfo( host.c_str(), service.str().c_str(), &hints, &addresses) != 0)
+    return NULL;
+
+  int fd = -1;
+  for (struct addrinfo* address = addresses; address != NULL; address = address->ai_next)
+  {
+    fd = ::socket( address->ai_family, address->ai_socktype, address->ai_protocol);
+    if ( fd < 0) continue;
+    if ( ::connect( fd, address->ai_addr, address->ai_addrlen) == 0) break;
+    ::close( fd);
+    fd = -1;
+  }
+  freeaddrinfo( addresses);
+  return fd < 0 ? NULL : new SocketTransport( fd);
+}
+
+int SocketTransport::listenTcp( int port)
+{
+  int fd = ::socket( AF_INET, SOCK_STREAM, 0);
+  if ( fd < 0) return -1;
+  int reuse = 1;
+  setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  struct sockaddr_in address;
+  std::memset( &address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl( INADDR_ANY);
+  address.sin_port = htons( port);
+  if ( ::bind( fd, (struct sockaddr*)&address, sizeof(address)) != 0 || ::listen( fd, 64) != 0)
+  {
+    ::close( fd);
+    return -1;
+  }
+  return fd;
+}
+
+SocketTransport* SocketTransport::acceptTcp( int listenFd)
+{
+  int fd = ::accept( listenFd, NULL, NULL);
+  return fd < 0 ? NULL : new SocketTransport( fd);
+}
+
+bool splitEdgeFile( const std::string& path, int numWorkers, std::vector<EdgePartition>& partitions)
+{
+  struct stat status;
+  if ( numWorkers < 1 || stat( path.c_str(), &status) != 0 || !S_ISREG( status.st_mode))
+    return false;
+  long long size = status.st_size;
+  partitions.clear();
+  for (int w = 0; w < numWorkers; ++w)
+  {
+    EdgePartition partition = { path, size*w/numWorkers, size*(w + 1)/numWorkers };
+    partitions.push_back( partition);
+  }
+  return true;
+}
+
+bool distributedMST( const std::vector<EdgePartition>& partitions, std::vector<Transport*>& workers, Graph& forest,
+		     std::vector<int>& components, DistributedReport& report)
+{
+  int numWorkers = workers.size();
+  report.bytesPerRound.clear();
+  report.roundNames.clear();
+  report.survivingEdges = 0;
+  if ( numWorkers == 0 || partitions.size() != workers.size())
+  {
+    std::cerr << "Need one partition per worker, got " << partitions.size() << " for " << numWorkers
+	      << " workers" << std::endl;
+    return false;
+  }
+
+  //Round 1: every worker learns which partition to load
+  size_t before = totalBytes( workers);
+  for (int w = 0; w < numWorkers; ++w)
+  {
+    std::vector<int> message;
+    appendLong( message, partitions[w].from);
+    appendLong( message, partitions[w].to);
+    message.push_back( partitions[w].path.size());
+    message.insert( message.end(), partitions[w].path.begin(), partitions[w].path.end());
+    if ( !workers[w]->send( message))
+    {
+      std::cerr << "Could not reach worker " << w << std::endl;
+      return false;
+    }
+  }
+  report.bytesPerRound.push_back( totalBytes( workers) - before);
+  report.roundNames.push_back( "assign partitions");
+
+  //Round 2: every worker reports the forest of its partition. Any worker
+  //missing means missing edges, so the run fails rather than return a wrong forest.
+  before = totalBytes( workers);
+  for (int w = 0; w < numWorkers; ++w)
+  {
+    int workerVertices, forestSize;
+    if ( !receiveStatus( *workers[w], w, partitions, workerVertices, forestSize))
+      return false;
+    report.survivingEdges += forestSize;
+  }
+  report.bytesPerRound.push_back( totalBytes( workers) - before);
+  report.roundNames.push_back( "filter partitions");
+
+  //Merge rounds: worker w + step hands its forest to worker w, through here.
+  //All of a round's forests are passed on before any merge is waited for,
+  //so the merges run side by side.
+  for (int step = 1; step < numWorkers; step *= 2)
+  {
+    before = totalBytes( workers);
+    for (int w = 0; w + step < numWorkers; w += 2*step)
+    {
+      std::vector<int> message;
+      if ( !takeForest( *workers[w + step], w + step, message))
+	return false;
+      if ( !workers[w]->send( std::vector<int>( 1, mergeForest)) || !workers[w]->send( message))
+      {
+	std::cerr << "Could not reach worker " << w << std::endl;
+	return false;
+      }
+    }
+    for (int w = 0; w + step < numWorkers; w += 2*step)
+    {
+      int workerVertices, forestSize;
+      if ( !receiveStatus( *workers[w], w, partitions, workerVertices, forestSize))
+	return false;
+    }
+    report.bytesPerRound.push_back( totalBytes( workers) - before);
+    std::ostringstream name;
+    name << "merge forests " << step << " apart";
+    report.roundNames.push_back( name.str());
+  }
+
+  //Last round: worker 0 holds the forest of the whole graph
+  before = totalBytes( workers);
+  std::vector<int> message;
+  EdgeList edges;
+  int numVertices;
+  if ( !takeForest( *workers[0], 0, message))
+    return false;
+  readForest( message, numVertices, &edges);
+  std::vector<int>().swap( message);
+  report.bytesPerRound.push_back( totalBytes( workers) - before);
+  report.roundNames.push_back( "collect the forest");
+
+  //The components are the forest's trees, numbered in order of their lowest vertex
+  std::vector<vertices_size_type> rank( numVertices + 1);
+  std::vector<vertex_descriptor> parent( numVertices + 1);
+  boost::disjoint_sets< vertices_size_type*, vertex_descriptor*> supervertices( &rank[0], &parent[0]);
+  for (int v = 0; v < numVertices; ++v)
+    supervertices.make_set(v);
+  forest = Graph( numVertices);
+  for (size_t i = 0; i < edges.size(); ++i)
+  {
+    boost::add_edge( edges[i].source, edges[i].target, edge_weight( edges[i].weight), forest);
+    supervertices.union_set( edges[i].source, edges[i].target);
+  }
+  std::vector<int> rootLabel( numVertices, -1);
+  int numComponents = 0;
+  components.resize( numVertices);
+  for (int v = 0; v < numVertices; ++v)
+  {
+    int root = supervertices.find_set(v);
+    if ( rootLabel[root] == -1)
+      rootLabel[root] = numComponents++;
+    components[v] = rootLabel[root];
+  }
+  return true;
+}
+
+bool runWorker( Transport& coordinator)
+{
+  std::vector<int> message;
+  if ( !coordinator.receive( message))
+    return false;
+
+  //The loader goes once its partition is filtered
+  EdgeList forest;
+  int numVertices;
+  {
+    EdgePartition partition;
+    MessageReader assignment( message);
+    PipelinedLoader loader;
+    if ( !assignment.readLong( partition.from) || !assignment.readLong( partition.to)
+	 || !assignment.readString( partition.path) || !assignment.done()
+	 || !loader.load( partition.path, partition.from, partition.to))
+    {
+      coordinator.send( std::vector<int>( 1, -1));
+      return false;
+    }
+
+    Graph partitionForest = kktMST( loader);
+    numVertices = loader.numVertices();
+    EdgeWeightMap weightMap = boost::get(boost::edge_weight_t(), partitionForest);
+    edge_iterator edgeBegin, edgeEnd;
+    for ( boost::tie( edgeBegin, edgeEnd) = boost::edges( partitionForest); edgeBegin != edgeEnd; ++edgeBegin)
+    {
+      WeightedEdge edge = { (int)boost::source( *edgeBegin, partitionForest), (int)boost::target( *edgeBegin, partitionForest),
+			    boost::get( weightMap, *edgeBegin), (int)forest.size() };
+      forest.push_back( edge);
+    }
+  }
+
+  while ( true)
+  {
+    std::vector<int> status;
+    status.push_back( numVertices);
+    status.push_back( forest.size());
+    if ( !coordinator.send( status) || !coordinator.receive( message) || message.size() != 1)
+      return false;
+
+    if ( message[0] == sendForest)
+    {
+      message.clear();
+      appendForest( message, numVertices, forest);
+      return coordinator.send( message);
+    }
+    if ( message[0] != mergeForest || !coordinator.receive( message))
+      return false;
+    if ( !mergeInto( message, numVertices, forest))
+    {
+      coordinator.send( std::vector<int>( 1, -1));
+      return false;
+    }
+  }
+}
+
+bool spawnLocalWorkers( int numWorkers, std::vector<Transport*>& workers)
+{
+  for (int w = 0; w < numWorkers; ++w)
+  {
+    int ends[2];
+    if ( socketpair( AF_UNIX, SOCK_STREAM, 0, ends) != 0)
+      return false;
+
+    pid_t pid = fork();
+    if ( pid < 0)
+    {
+      ::close( ends[0]);
+      ::close( ends[1]);
+      return false;
+    }
+    if ( pid == 0)
+    {
+      //Drop the coordinator's sockets so earlier workers still see it hang up
+      ::close( ends[0]);
+      for (size_t i = 0; i < localFds.size(); ++i)
+	::close( localFds[i]);
+      SocketTransport coordinator( ends[1]);
+      runWorker( coordinator);
+      _exit(0);
+    }
+    ::close( ends[1]);
+    localPids.push_back( pid);
+    localFds.push_back( ends[0]);
+    workers.push_back( new SocketTransport( ends[0]));
+  }
+  return true;
+}
+
+void waitForLocalWorkers( std::vector<Transport*>& workers)
+{
+  for (size_t w = 0; w < workers.size(); ++w)
+    delete workers[w];
+  workers.clear();
+  for (size_t i = 0; i < localPids.size(); ++i)
+    waitpid( localPids[i], NULL, 0);
+  localPids.clear();
+  localFds.clear();
+}
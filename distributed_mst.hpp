@@ -0,0 +1,118 @@
+//Distributed MST hpp
+//Worker processes load and filter their own share of the edges before a final kktMST.
+
+#ifndef DISTRIBUTED_MST_H
+#define DISTRIBUTED_MST_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "boruvka_tree/BoruvkaTree.hpp"
+
+//A two way channel carrying messages made of ints. The distributed code
+//only talks through this, so any transport can be plugged in.
+class Transport
+{
+  public:
+    Transport();
+    virtual ~Transport();
+
+    virtual bool send( const std::vector<int>& message) = 0;
+    virtual bool receive( std::vector<int>& message) = 0;
+
+    size_t getBytesSent() const;
+    size_t getBytesReceived() const;
+
+  protected:
+    size_t bytesSent;
+    size_t bytesReceived;
+};
+
+//Transport over a connected stream socket: a Unix socket pair for local
+//runs or a TCP connection for remote workers. receive() fails on frames
+//longer than maxMessageInts instead of allocating whatever they claim.
+class SocketTransport : public Transport
+{
+  public:
+    SocketTransport( int fd, size_t maxMessageInts = (size_t)1 << 30);
+    ~SocketTransport();
+
+    bool send( const std::vector<int>& message);
+    bool receive( std::vector<int>& message);
+
+    //Both return NULL on failure
+    static SocketTransport* connectTcp( const std::string& host, int port);
+    static SocketTransport* acceptTcp( int listenFd);
+    //Returns a listening socket, or -1 on failure
+    static int listenTcp( int port);
+
+  private:
+    int fd;
+    size_t maxMessageInts;
+};
+
+//Where a worker finds its edges: the lines of an edge list file, in the
+//format PipelinedLoader reads, whose first byte lies in [from, to). to < 0
+//means the end of the file.
+struct EdgePartition
+{
+  std::string path;
+  long long from;
+  long long to;
+};
+
+/**
+ * @var const std::string& - path - Edge list file
+ * @var int - numWorkers - Number of partitions
+ * @var std::vector<EdgePartition>& - partitions - Filled with byte ranges of equal size
+ * @return bool False if the file can't be examined
+ */
+bool splitEdgeFile( const std::string& path, int numWorkers, std::vector<EdgePartition>& partitions);
+
+//Bytes moved between the coordinator and all workers, per round
+struct DistributedReport
+{
+  std::vector<size_t> bytesPerRound;
+  std::vector<std::string> roundNames;
+  size_t survivingEdges; //edges in the partitions' own forests, over all workers
+};
+
+/**
+ * @var const std::vector<EdgePartition>& - partitions - Partition of the input for every worker
+ * @var std::vector<Transport*>& - workers - One connected transport per partition
+ * @var Graph& - forest - Set to the minimum spanning forest
+ * @var std::vector<int>& - components - Filled with a component label per vertex
+ * @var DistributedReport& - report - Filled with the bytes communicated per round
+ * @return bool False if a worker failed, hung up or sent a malformed reply;
+ * forest and components are not set then
+ * Coordinator side: tells every worker which partition to load, then has the
+ * workers merge their forests pairwise, relaying one forest at a time, until
+ * worker 0 holds the forest of the whole graph. The components are read off
+ * that forest. Vertices are numbered 0 .. the largest id in the input.
+ */
+bool distributedMST( const std::vector<EdgePartition>& partitions, std::vector<Transport*>& workers, Graph& forest,
+		     std::vector<int>& components, DistributedReport& report);
+
+/**
+ * @var Transport& - coordinator - Connection to the coordinator
+ * @return bool False if the connection broke, the partition couldn't be read
+ * or a forest it was sent was malformed
+ * Worker side: loads its partition and reduces it to its forest with kktMST,
+ * then merges in the forests it is sent with kktForest until it is asked to
+ * send its own.
+ */
+bool runWorker( Transport& coordinator);
+
+/**
+ * @var int - numWorkers - Number of worker processes to fork
+ * @var std::vector<Transport*>& - workers - Filled with the coordinator's end of each socket pair
+ * @return bool False if a socket pair or fork failed
+ * Starts local workers for testing; each one runs runWorker and exits.
+ */
+bool spawnLocalWorkers( int numWorkers, std::vector<Transport*>& workers);
+
+//Closes the workers' transports and reaps any local worker processes
+void waitForLocalWorkers( std::vector<Transport*>& workers);
+
+#endif
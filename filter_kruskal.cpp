@@ -0,0 +1,229 @@
+/*
+ * Filter-Kruskal (Osipov, Sanders, Singler). Quicksort-style partitioning
+ * means the heavy edges are only sorted once the light ones have had the
+ * chance to connect their endpoints, and on sparse graphs most of them
+ * never get sorted at all. The union-find is only written by the
+ * sequential Kruskal scans, so the parallel filter can read it without
+ * locks, using finds that don't compress paths.
+ */
+
+#include "filter_kruskal.hpp"
+#include "large_array.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+namespace
+{
+  const size_t baseCaseSize = 1 << 15;  //partitions this small are sorted outright
+  const size_t parallelGrain = 1 << 14; //fewest edges worth handing to a thread
+  const int sampleSize = 31;
+
+  //Keeps the edges that are not heavier than the pivot
+  struct NotHeavier
+  {
+    WeightedEdge pivot;
+    bool operator()( const WeightedEdge& edge) const { return !compareByWeight( pivot, edge); }
+  };
+
+  class FilterKruskal
+  {
+    public:
+      FilterKruskal( int numVertices, std::vector<int>& forest, int numThreads);
+
+      void solve( WeightedEdge* first, WeightedEdge* last);
+
+    private:
+      int numVertices;
+      int numThreads;
+      int numTreeEdges;
+      std::vector<int>* forest;
+      LargeArray<int> parent, rank;
+
+      int find( int v);
+      int findReadOnly( int v) const;
+      void kruskal( WeightedEdge* first, WeightedEdge* last);
+      WeightedEdge* filter( WeightedEdge* first, WeightedEdge* last);
+      void parallelSort( WeightedEdge* first, WeightedEdge* last);
+      int threadsFor( size_t numEdges) const;
+      bool done() const { return numTreeEdges >= numVertices - 1; }
+
+      static void filterRange( const FilterKruskal* engine, WeightedEdge* first, WeightedEdge* last,
+			       size_t* kept);
+      static void sortRange( WeightedEdge* first, WeightedEdge* last);
+      static void mergeRanges( WeightedEdge* first, WeightedEdge* middle, WeightedEdge* last);
+  };
+
+  FilterKruskal::FilterKruskal( int numVertices, std::vector<int>& forest, int numThreads)
+    : parent( numVertices), rank( numVertices, 0)
+  {
+    this->numVertices = numVertices;
+    this->numThreads = numThreads > 0 ? numThreads : 1;
+    this->numTreeEdges = 0;
+    this->forest = &forest;
+    for (int v = 0; v < numVertices; ++v)
+      parent[v] = v;
+  }
+
+  //Path halving; only called from the sequential Kruskal scans
+  int FilterKruskal::find( int v)
+  {
+    while ( parent[v] != v)
+    {
+      parent[v] = parent[parent[v]];
+      v = parent[v];
+    }
+    return v;
+  }
+
+  //Union by rank keeps the trees O(log n) deep even without compression
+  int FilterKruskal::findReadOnly( int v) const
+  {
+    while ( parent[v] != v)
+      v = parent[v];
+    return v;
+  }
+
+  int FilterKruskal::threadsFor( size_t numEdges) const
+  {
+    return (int)std::min( (size_t)numThreads, numEdges / parallelGrain + 1);
+  }
+
+  void FilterKruskal::solve( WeightedEdge* first, WeightedEdge* last)
+  {
+    if ( done() || first == last)
+      return;
+    if ( (size_t)(last - first) <= baseCaseSize)
+    {
+      kruskal( first, last);
+      return;
+    }
+
+    WeightedEdge sample[sampleSize];
+    for (int i = 0; i < sampleSize; ++i)
+      sample[i] = first[std::rand() % (last - first)];
+    std::nth_element( sample, sample + sampleSize/2, sample + sampleSize, compareByWeight);
+    NotHeavier light = { sample[sampleSize/2] };
+    WeightedEdge* middle = std::partition( first, last, light);
+    if ( middle == last) //the pivot was the heaviest edge in the range
+    {
+      kruskal( first, last);
+      return;
+    }
+
+    solve( first, middle);
+    if ( done())
+      return;
+    solve( middle, filter( middle, last));
+  }
+
+  void FilterKruskal::kruskal( WeightedEdge* first, WeightedEdge* last)
+  {
+    parallelSort( first, last);
+    for ( ; first != last && !done(); ++first)
+    {
+      int u = find( first->source), v = find( first->target);
+      if ( u == v)
+	continue;
+      if ( rank[u] < rank[v]) std::swap( u, v);
+      parent[v] = u;
+      if ( rank[u] == rank[v]) ++rank[u];
+      forest->push_back( first->id);
+      ++numTreeEdges;
+    }
+  }
+
+  /**
+   * Drops the edges whose endpoints are already connected. Every thread
+   * compacts its own slice in place, then the slices are closed up.
+   */
+  WeightedEdge* FilterKruskal::filter( WeightedEdge* first, WeightedEdge* last)
+  {
+    int threads = threadsFor( last - first);
+    if ( threads == 1)
+    {
+      //Alone, the filter may compress paths as it goes
+      WeightedEdge* out = first;
+      for (WeightedEdge* edge = first; edge != last; ++edge)
+	if ( find( edge->source) != find( edge->target))
+	  *out++ = *edge;
+      return out;
+    }
+
+    size_t numEdges = last - first;
+    std::vector<size_t> kept( threads);
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t)
+      workers.push_back( std::thread( filterRange, this, first + numEdges*t/threads,
+				      first + numEdges*(t + 1)/threads, &kept[t]));
+    filterRange( this, first, first + numEdges/threads, &kept[0]);
+    for (size_t t = 0; t < workers.size(); ++t)
+      workers[t].join();
+
+    WeightedEdge* out = first + kept[0];
+    for (int t = 1; t < threads; ++t)
+    {
+      WeightedEdge* slice = first + numEdges*t/threads;
+      out = std::copy( slice, slice + kept[t], out);
+    }
+    return out;
+  }
+
+  void FilterKruskal::filterRange( const FilterKruskal* engine, WeightedEdge* first, WeightedEdge* last,
+				   size_t* kept)
+  {
+    WeightedEdge* out = first;
+    for (WeightedEdge* edge = first; edge != last; ++edge)
+      if ( engine->findReadOnly( edge->source) != engine->findReadOnly( edge->target))
+	*out++ = *edge;
+    *kept = out - first;
+  }
+
+  /**
+   * Sorts numThreads slices side by side, then merges neighbouring runs in
+   * rounds, every merge of a round on its own thread.
+   */
+  void FilterKruskal::parallelSort( WeightedEdge* first, WeightedEdge* last)
+  {
+    int threads = threadsFor( last - first);
+    size_t numEdges = last - first;
+    std::vector<WeightedEdge*> bounds;
+    for (int t = 0; t <= threads; ++t)
+      bounds.push_back( first + numEdges*t/threads);
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t)
+      workers.push_back( std::thread( sortRange, bounds[t], bounds[t + 1]));
+    sortRange( bounds[0], bounds[1]);
+    for (size_t t = 0; t < workers.size(); ++t)
+      workers[t].join();
+
+    for (size_t width = 1; width < (size_t)threads; width *= 2)
+    {
+      workers.clear();
+      for (size_t t = 0; t + width < (size_t)threads; t += 2*width)
+	workers.push_back( std::thread( mergeRanges, bounds[t], bounds[t + width],
+					bounds[std::min( t + 2*width, (size_t)threads)]));
+      for (size_t t = 0; t < workers.size(); ++t)
+	workers[t].join();
+    }
+  }
+
+  void FilterKruskal::sortRange( WeightedEdge* first, WeightedEdge* last)
+  {
+    std::sort( first, last, compareByWeight);
+  }
+
+  void FilterKruskal::mergeRanges( WeightedEdge* first, WeightedEdge* middle, WeightedEdge* last)
+  {
+    std::inplace_merge( first, middle, last, compareByWeight);
+  }
+}
+
+void filterKruskal( int numVertices, EdgeList& edges, std::vector<int>& forest,
+		    int numThreads)
+{
+  FilterKruskal engine( numVertices, forest, numThreads);
+  engine.solve( edges.data(), edges.data() + edges.size());
+}
@@ -0,0 +1,25 @@
+//Filter-Kruskal hpp
+//Kruskal's algorithm that only sorts the edges it can't rule out first.
+
+#ifndef FILTER_KRUSKAL_H
+#define FILTER_KRUSKAL_H
+
+#include <vector>
+
+#include "weighted_edge.hpp"
+
+/**
+ * @var int - numVertices - Vertices are numbered 0 .. numVertices - 1
+ * @var EdgeList& - edges - Edge list; consumed by the call
+ * @var std::vector<int>& - forest - The ids of the minimum spanning forest edges are appended here
+ * @var int - numThreads - Threads for filtering and sorting
+ * Splits the edges around a pivot sampled from them and solves the light
+ * side first. Heavy edges whose endpoints the light side already connected
+ * are filtered out in parallel before the heavy side is split in turn, and
+ * small enough sides are sorted in parallel and scanned as in Kruskal.
+ * Weight ties are broken by id.
+ */
+void filterKruskal( int numVertices, EdgeList& edges, std::vector<int>& forest,
+		    int numThreads = 1);
+
+#endif
@@ -0,0 +1,379 @@
+/*
+ * Euclidean MST front end. A k-d tree over the points records, for every
+ * node, the component all of its points belong to (or -1 when mixed), so a
+ * nearest-point-in-another-component search skips whole subtrees that lie
+ * inside the query's own component. Running Boruvka rounds with that search
+ * yields the MST edges directly and never looks at the O(n^2) complete graph.
+ */
+
+#include "geometric_mst.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace
+{
+  const int leafSize = 8;
+
+  struct KdNode
+  {
+    double low[3];       //bounding box of the points
+    double high[3];
+    double cellLow[3];   //region cut out by the splits above, which holds no other point
+    double cellHigh[3];
+    int begin;
+    int end;
+    int left;
+    int right;
+    int parent;
+    int component; //shared by every point below, -1 if they differ
+  };
+
+  class KdTree
+  {
+    public:
+      KdTree( int dimension, const std::vector<double>& coords);
+
+      void updateComponents( const std::vector<int>& component);
+      //Closest point outside component whose squared distance is at most bestDist
+      void nearestForeign( int point, int component, const std::vector<int>& pointComponent,
+			   int& best, double& bestDist) const;
+      //Squared distance from the point at a tree position to the edge of the largest
+      //cell around it holding only its own component; 0 if its leaf is mixed
+      double interiorDistance( int position) const;
+
+      std::vector<int> order; //points in tree order; every node owns a range of it
+
+    private:
+      int dimension;
+      const double* coords;
+      std::vector<KdNode> nodes;
+      std::vector<int> uniformTop; //per tree position, the largest single component node above it
+
+      int build( int begin, int end, int parent, const double* cellLow, const double* cellHigh);
+      double boxDistance( const KdNode& node, const double* point) const;
+      void search( int node, double nodeDistance, int point, int component, const std::vector<int>& pointComponent,
+		   int& best, double& bestDist) const;
+  };
+
+  struct ByCoordinate
+  {
+    const double* coords;
+    int dimension;
+    int axis;
+    bool operator()( int a, int b) const { return coords[a*dimension + axis] < coords[b*dimension + axis]; }
+  };
+
+  KdTree::KdTree( int dimension, const std::vector<double>& coords)
+  {
+    this->dimension = dimension;
+    this->coords = coords.data();
+    int numPoints = coords.size() / dimension;
+    order.resize( numPoints);
+    for (int i = 0; i < numPoints; ++i)
+      order[i] = i;
+    uniformTop.assign( numPoints, -1);
+    nodes.reserve( 2*(numPoints/leafSize + 1));
+    double cellLow[3], cellHigh[3];
+    for (int d = 0; d < 3; ++d)
+    {
+      cellLow[d] = -std::numeric_limits<double>::infinity();
+      cellHigh[d] = std::numeric_limits<double>::infinity();
+    }
+    if ( numPoints > 0)
+      build( 0, numPoints, -1, cellLow, cellHigh);
+  }
+
+  /**
+   * Builds the subtree over order[begin, end), splitting at the median of the
+   * widest axis. Children always come after their parent in nodes.
+   */
+  int KdTree::build( int begin, int end, int parent, const double* cellLow, const double* cellHigh)
+  {
+    int index = nodes.size();
+    nodes.push_back( KdNode());
+    KdNode node;
+    node.begin = begin;
+    node.end = end;
+    node.left = node.right = -1;
+    node.parent = parent;
+    node.component = -1;
+    for (int d = 0; d < dimension; ++d)
+    {
+      node.cellLow[d] = cellLow[d];
+      node.cellHigh[d] = cellHigh[d];
+      node.low[d] = (std::numeric_limits<double>::max)();
+      node.high[d] = -(std::numeric_limits<double>::max)();
+    }
+    for (int i = begin; i < end; ++i)
+    {
+      for (int d = 0; d < dimension; ++d)
+      {
+	node.low[d] = std::min( node.low[d], coords[order[i]*dimension + d]);
+	node.high[d] = std::max( node.high[d], coords[order[i]*dimension + d]);
+      }
+    }
+
+    if ( end - begin > leafSize)
+    {
+      int axis = 0;
+      for (int d = 1; d < dimension; ++d)
+	if ( node.high[d] - node.low[d] > node.high[axis] - node.low[axis]) axis = d;
+      int middle = begin + (end - begin)/2;
+      ByCoordinate byCoordinate = { coords, dimension, axis };
+      std::nth_element( order.begin() + begin, order.begin() + middle, order.begin() + end, byCoordinate);
+      //Points equal to the split value may land on either side, so both cells include it
+      double split = coords[order[middle]*dimension + axis];
+      double childLow[3], childHigh[3];
+      std::copy( cellLow, cellLow + 3, childLow);
+      std::copy( cellHigh, cellHigh + 3, childHigh);
+      childHigh[axis] = split;
+      node.left = build( begin, middle, index, childLow, childHigh);
+      childHigh[axis] = cellHigh[axis];
+      childLow[axis] = split;
+      node.right = build( middle, end, index, childLow, childHigh);
+    }
+    nodes[index] = node;
+    return index;
+  }
+
+  void KdTree::updateComponents( const std::vector<int>& component)
+  {
+    for (int i = (int)nodes.size() - 1; i >= 0; --i)
+    {
+      KdNode& node = nodes[i];
+      if ( node.left == -1)
+      {
+	node.component = component[order[node.begin]];
+	for (int p = node.begin + 1; p < node.end && node.component != -1; ++p)
+	  if ( component[order[p]] != node.component) node.component = -1;
+      }
+      else
+      {
+	int left = nodes[node.left].component;
+	node.component = left == nodes[node.right].component ? left : -1;
+      }
+    }
+
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+      const KdNode& node = nodes[i];
+      if ( node.component == -1 || (node.parent != -1 && nodes[node.parent].component != -1))
+	continue;
+      for (int p = node.begin; p < node.end; ++p)
+	uniformTop[p] = i;
+    }
+  }
+
+  double KdTree::interiorDistance( int position) const
+  {
+    if ( uniformTop[position] == -1)
+      return 0;
+    const KdNode& cell = nodes[uniformTop[position]];
+    const double* p = coords + order[position]*dimension;
+    double distance = std::numeric_limits<double>::infinity();
+    for (int d = 0; d < dimension; ++d)
+      distance = std::min( distance, std::min( p[d] - cell.cellLow[d], cell.cellHigh[d] - p[d]));
+    return distance*distance;
+  }
+
+  double KdTree::boxDistance( const KdNode& node, const double* point) const
+  {
+    double distance = 0;
+    for (int d = 0; d < dimension; ++d)
+    {
+      double gap = std::max( 0.0, std::max( node.low[d] - point[d], point[d] - node.high[d]));
+      distance += gap*gap;
+    }
+    return distance;
+  }
+
+  void KdTree::nearestForeign( int point, int component, const std::vector<int>& pointComponent,
+			       int& best, double& bestDist) const
+  {
+    if ( !nodes.empty())
+      search( 0, boxDistance( nodes[0], coords + point*dimension), point, component, pointComponent, best, bestDist);
+  }
+
+  void KdTree::search( int index, double nodeDistance, int point, int component, const std::vector<int>& pointComponent,
+		       int& best, double& bestDist) const
+  {
+    const KdNode& node = nodes[index];
+    const double* p = coords + point*dimension;
+    if ( node.component == component || nodeDistance > bestDist)
+      return;
+
+    if ( node.left == -1)
+    {
+      for (int i = node.begin; i < node.end; ++i)
+      {
+	int other = order[i];
+	if ( pointComponent[other] == component)
+	  continue;
+	double distance = 0;
+	for (int d = 0; d < dimension; ++d)
+	{
+	  double gap = coords[other*dimension + d] - p[d];
+	  distance += gap*gap;
+	}
+	//Equal distances go to the lower point so every search agrees
+	if ( distance < bestDist || (distance == bestDist && (best == -1 || other < best)))
+	{
+	  best = other;
+	  bestDist = distance;
+	}
+      }
+      return;
+    }
+
+    int nearer = node.left, farther = node.right;
+    double nearerDistance = boxDistance( nodes[nearer], p), fartherDistance = boxDistance( nodes[farther], p);
+    if ( fartherDistance < nearerDistance)
+    {
+      std::swap( nearer, farther);
+      std::swap( nearerDistance, fartherDistance);
+    }
+    search( nearer, nearerDistance, point, component, pointComponent, best, bestDist);
+    search( farther, fartherDistance, point, component, pointComponent, best, bestDist);
+  }
+
+  //(distance, lower point, higher point) order, so ties never close a cycle
+  bool shorter( double distance1, int a1, int b1, double distance2, int a2, int b2)
+  {
+    if ( distance1 != distance2) return distance1 < distance2;
+    if ( std::min(a1, b1) != std::min(a2, b2)) return std::min(a1, b1) < std::min(a2, b2);
+    return std::max(a1, b1) < std::max(a2, b2);
+  }
+
+  /**
+   * Nearest foreign point for the points at tree positions [begin, end).
+   * Components only grow, so a nearest point from the last round that is
+   * still foreign is still the nearest one. Only the shortest edge leaving
+   * each component is kept in the end, so the best distance seen so far for
+   * a component bounds the searches of its other points, and points deeper
+   * inside a single component cell than that bound are skipped outright.
+   */
+  void nearestRange( const KdTree* tree, const std::vector<int>* component, int numComponents,
+		     std::vector<int>* nearest, std::vector<double>* nearestDist, int begin, int end)
+  {
+    std::vector<double> bound( numComponents, (std::numeric_limits<double>::max)());
+    for (int i = begin; i < end; ++i)
+    {
+      int point = tree->order[i];
+      int c = (*component)[point];
+      int best = (*nearest)[point];
+      if ( best != -1 && (*component)[best] != c)
+      {
+	bound[c] = std::min( bound[c], (*nearestDist)[point]);
+	continue;
+      }
+      best = -1;
+      double bestDist = bound[c];
+      if ( tree->interiorDistance(i) <= bestDist)
+	tree->nearestForeign( point, c, *component, best, bestDist);
+      (*nearest)[point] = best;
+      (*nearestDist)[point] = bestDist;
+      if ( best != -1)
+	bound[c] = bestDist;
+    }
+  }
+}
+
+void euclideanCandidates( int dimension, const std::vector<double>& coords, std::vector<WeightedEdge>& candidates,
+			  std::vector<double>& lengths, int numThreads)
+{
+  int numPoints = coords.size() / dimension;
+  candidates.clear();
+  lengths.clear();
+  if ( numThreads < 1) numThreads = 1;
+
+  KdTree tree( dimension, coords);
+  std::vector<vertices_size_type> rank( numPoints + 1);
+  std::vector<vertex_descriptor> parent( numPoints + 1);
+  boost::disjoint_sets< vertices_size_type*, vertex_descriptor*> supervertices( &rank[0], &parent[0]);
+  std::vector<int> component( numPoints);
+  for (int i = 0; i < numPoints; ++i)
+  {
+    supervertices.make_set(i);
+    component[i] = i;
+  }
+
+  std::vector<int> nearest( numPoints, -1), componentBest( numPoints), rootLabel( numPoints);
+  std::vector<double> nearestDist( numPoints);
+  int numComponents = numPoints;
+  while ( numComponents > 1)
+  {
+    tree.updateComponents( component);
+
+    std::vector<std::thread> threads;
+    int chunk = (numPoints + numThreads - 1) / numThreads;
+    for (int t = 1; t < numThreads && t*chunk < numPoints; ++t)
+      threads.push_back( std::thread( nearestRange, &tree, &component, numComponents, &nearest, &nearestDist,
+				      t*chunk, std::min( numPoints, (t + 1)*chunk)));
+    nearestRange( &tree, &component, numComponents, &nearest, &nearestDist, 0, std::min( numPoints, chunk));
+    for (size_t t = 0; t < threads.size(); ++t)
+      threads[t].join();
+
+    //Shortest edge leaving each component
+    std::fill( componentBest.begin(), componentBest.begin() + numComponents, -1);
+    for (int i = 0; i < numPoints; ++i)
+    {
+      if ( nearest[i] == -1)
+	continue;
+      int& best = componentBest[component[i]];
+      if ( best == -1 || shorter( nearestDist[i], i, nearest[i], nearestDist[best], best, nearest[best]))
+	best = i;
+    }
+
+    for (int c = 0; c < numComponents; ++c)
+    {
+      int i = componentBest[c];
+      if ( i == -1)
+	continue;
+      vertex_descriptor a = supervertices.find_set(i);
+      vertex_descriptor b = supervertices.find_set( nearest[i]);
+      if ( a != b)
+      {
+	supervertices.link(a, b);
+	WeightedEdge edge = { i, nearest[i], 0, (int)candidates.size() };
+	candidates.push_back( edge);
+	lengths.push_back( std::sqrt( nearestDist[i]));
+      }
+    }
+
+    //Number the merged components 0 .. numComponents-1
+    std::fill( rootLabel.begin(), rootLabel.end(), -1);
+    numComponents = 0;
+    for (int i = 0; i < numPoints; ++i)
+    {
+      int& label = rootLabel[supervertices.find_set(i)];
+      if ( label == -1)
+	label = numComponents++;
+      component[i] = label;
+    }
+  }
+}
+
+Graph euclideanGraph( int dimension, const std::vector<double>& coords, int numThreads)
+{
+  std::vector<WeightedEdge> candidates;
+  std::vector<double> lengths;
+  euclideanCandidates( dimension, coords, candidates, lengths, numThreads);
+  return candidateGraph( coords.size() / dimension, candidates, lengths);
+}
+
+Graph candidateGraph( int numPoints, const std::vector<WeightedEdge>& candidates, const std::vector<double>& lengths)
+{
+  double longest = 0;
+  for (size_t i = 0; i < lengths.size(); ++i)
+    longest = std::max( longest, lengths[i]);
+  double scale = longest > 0 ? ((std::numeric_limits<int>::max)() / 2) / longest : 1;
+
+  Graph graph( numPoints);
+  for (size_t i = 0; i < candidates.size(); ++i)
+    boost::add_edge( candidates[i].source, candidates[i].target,
+		     edge_weight( (int)(lengths[i]*scale + 0.5)), graph);
+  return graph;
+}
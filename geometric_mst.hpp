@@ -0,0 +1,43 @@
+//Geometric MST hpp
+//Sparse candidate graphs for Euclidean MSTs of 2D and 3D point sets.
+
+#ifndef GEOMETRIC_MST_H
+#define GEOMETRIC_MST_H
+
+#include <vector>
+
+#include "boruvka_tree/BoruvkaTree.hpp"
+#include "weighted_edge.hpp"
+
+/**
+ * @var int - dimension - 2 or 3
+ * @var const std::vector<double>& - coords - dimension coordinates per point, point after point
+ * @var std::vector<WeightedEdge>& - candidates - Filled with the candidate edges; weights are unset
+ * @var std::vector<double>& - lengths - Filled with the Euclidean length of every candidate
+ * @var int - numThreads - Threads for the nearest neighbor searches
+ * Builds a candidate set that contains a Euclidean MST. Every round each
+ * component adds its nearest point in another component, found with a k-d
+ * tree; by the cut property all of these are MST edges, so the rounds stop
+ * with at most n - 1 candidates after O(log n) rounds.
+ */
+void euclideanCandidates( int dimension, const std::vector<double>& coords, std::vector<WeightedEdge>& candidates,
+			  std::vector<double>& lengths, int numThreads = 1);
+
+/**
+ * @var int - dimension - 2 or 3
+ * @var const std::vector<double>& - coords - dimension coordinates per point
+ * @var int - numThreads - Threads for the nearest neighbor searches
+ * @return Graph One vertex per point and the candidate edges, ready for kktMST
+ * Lengths are scaled onto the int range so their order is kept.
+ */
+Graph euclideanGraph( int dimension, const std::vector<double>& coords, int numThreads = 1);
+
+/**
+ * @var int - numPoints - Number of points
+ * @var const std::vector<WeightedEdge>& - candidates - Candidates from euclideanCandidates
+ * @var const std::vector<double>& - lengths - Their lengths, from the same call
+ * @return Graph The graph euclideanGraph returns, for callers that already have the candidates
+ */
+Graph candidateGraph( int numPoints, const std::vector<WeightedEdge>& candidates, const std::vector<double>& lengths);
+
+#endif
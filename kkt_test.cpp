@@ -4,17 +4,32 @@
  * @brief KKT randomized MST algorithm.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 #include <ctime>
+#include <unistd.h>
+#include <limits>
 
 #include "boost/graph/graph_traits.hpp"
 #include "boost/graph/adjacency_list.hpp"
+#include "boost/graph/connected_components.hpp"
 #include "boost/graph/kruskal_min_spanning_tree.hpp"
 #include "boost/pending/disjoint_sets.hpp"
 
+#include "kkt_test.hpp"
+#include "batch_mst.hpp"
+#include "distributed_mst.hpp"
+#include "filter_kruskal.hpp"
+#include "geometric_mst.hpp"
+#include "large_array.hpp"
+#include "path_max_index.hpp"
 #include "verification.hpp"
 #include "boruvka_tree/BoruvkaNode.hpp"
 #include "boruvka_tree/BoruvkaTree.hpp"
@@ -44,61 +59,208 @@ typedef std::pair<edge_descriptor, int> w_edge; //weighted edge
 typedef vertices_size_type* Rank;
 typedef vertex_descriptor* Parent;
 
-std::vector<vertices_size_type> rank(numNodes);
-std::vector<vertex_descriptor> parent(numNodes);
-boost::disjoint_sets< Rank, Parent> dset( &rank[0], &parent[0]); //Simplifies Boruvka step
-std::map<int, vertex_descriptor> supervertex_map;
-std::vector<vertex_descriptor> supervertices;
+LargeArray<vertices_size_type> rank(numNodes);
+LargeArray<vertex_descriptor> parent(numNodes);
+boost::disjoint_sets< Rank, Parent> dset( &rank[0], &parent[0]); //Links the final forest into components
 
 /**
- * @var boost::adjacency_list - graph - Adjacency List representation of a graph
- * @var int - numNodes - Number of nodes our graph contains
- * @return void Updates the graph instead of returning anything
- * Fills the graph with nodes and edges. Each vertex has a 1/1000 chance of beinga
- * connected to another vertex, meaning each vertex will have 10 outgoing edges
- * on average.
+ * @var int - numGraphs - Number of random graphs in the batch
+ * @var int - graphSize - Vertices per graph; each has three times as many edges
+ * Reports graphs per second for BatchMST against calling kktMST on every graph.
+ * Wall clock time is used since BatchMST runs on several threads.
  */
-void createGraph( Graph& graph);
+void batchBenchmark( int numGraphs, int graphSize);
 
 /**
- * @var Graph& - graph - The input graph to run this algorithm on
- * @return Graph Returns a graph object with all the verticesand only the edges in the MST
- * Runs the KKT MST algorithm on provied graph
+ * @var const std::vector<EdgePartition>& - partitions - Partition of the input for every worker
+ * @var std::vector<Transport*>& - workers - Connected workers
+ * @return bool False if the run failed
+ * Runs distributedMST and prints the bytes communicated per round.
  */
-Graph kktMST( Graph& graph);
+bool distributedRun( const std::vector<EdgePartition>& partitions, std::vector<Transport*>& workers);
 
 /**
- * @var boost::adjacency_list - graph - Adjacency List representation of a graph
- * @return graph Returns a condensed version of the graph
- * Condenses the graph using the Boruvka algorithm
+ * @var int - numPoints - Number of random points in the unit square or cube
+ * @var int - dimension - 2 or 3
+ * Times the k-d tree candidate search and kktMST on the candidate graph.
  */
-Graph boruvkaCut( Graph& graph, int createTree, BoruvkaTree& boruvkaTree);
+void geometricBenchmark( int numPoints, int dimension);
 
 /**
- * @ver w_edge - edge1 - Representation of the first edge
- * @var w_edge - edge2 - Representation of the second edge
- * @return w_edge Lower weight edge
- * Returns the minimum of two input edges, based on edge weight
+ * @var Graph& - graph - The input graph
+ * @var const MemoryPolicy& - policy - Pages and placement to compare against the default
+ * Reports kktMSF throughput with the default allocation and with policy. The
+ * global union-find arrays are reallocated under each policy as well.
  */
-w_edge findMinWeightEdge( w_edge edge1, w_edge edge2);
+void memoryBenchmark( Graph& graph, const MemoryPolicy& policy);
+
+/**
+ * @var const std::string& - path - Edge list file, "source target weight" per line
+ * @var int - numWorkers - Loader threads updating the Boruvka candidates
+ * Times the pipelined loader plus kktMST against loading first and running
+ * the whole of kktForest afterwards.
+ */
+void loadBenchmark( const std::string& path, int numWorkers);
+
+/**
+ * @var int - numGraphs - Number of random multigraphs to check
+ * @return bool True if every forest matched
+ * Regression check for the forest core. Runs kktMSF with both engines and
+ * kktMST on the compressed graph on random multigraphs with loops, parallel
+ * edges, isolated vertices and several components, and compares the forests
+ * with boost's Kruskal and the labels with boost's connected components.
+ * PathMaxIndex is checked on every Kruskal forest against a walk along it,
+ * and the same graphs then go through BatchMST as one batch. The graphs come from std::rand,
+ * which main seeds once, so every iteration draws a new one.
+ */
+bool checkForests( int numGraphs);
+
+//Defined with the Boruvka steps below
+static int compactEdges( int numVertices, EdgeList& edges);
+static void linkCandidates( int numVertices, const WeightedEdge* candidate_edges,
+			    boost::disjoint_sets< Rank, Parent>& supervertices, std::vector<int>& picked);
 
 int main( int argc, char* argv[])
 {
   clock_t begin, end;
   double time_spent;
   
+  //Seeded once for the whole run; --check takes a seed to replay a failure
+  unsigned seed = time(NULL);
+  if ( argc > 3 && std::string( argv[1]) == "--check")
+    seed = std::strtoul( argv[3], NULL, 10);
+  std::srand( seed);
+  
+  if ( argc > 1 && std::string( argv[1]) == "--check")
+  {
+    if ( checkForests( argc > 2 ? std::atoi( argv[2]) : 200))
+      return 0;
+    std::cerr << "Replay with --check " << (argc > 2 ? argv[2] : "200") << " " << seed << std::endl;
+    return 1;
+  }
+  
+  if ( argc > 1 && std::string( argv[1]) == "--batch")
+  {
+    batchBenchmark( argc > 2 ? std::atoi( argv[2]) : 100000, argc > 3 ? std::atoi( argv[3]) : 100);
+    return 0;
+  }
+  
+  if ( argc > 3 && std::string( argv[1]) == "--worker")
+  {
+    SocketTransport* coordinator = SocketTransport::connectTcp( argv[2], std::atoi( argv[3]));
+    if ( coordinator == NULL)
+    {
+      std::cerr << "Could not reach the coordinator at " << argv[2] << ":" << argv[3] << std::endl;
+      return 1;
+    }
+    bool finished = runWorker( *coordinator);
+    delete coordinator;
+    return finished ? 0 : 1;
+  }
+  
+  if ( argc > 2 && std::string( argv[1]) == "--distributed")
+  {
+    //Local workers splitting one edge list file between them
+    std::vector<EdgePartition> partitions;
+    if ( !splitEdgeFile( argv[2], argc > 3 ? std::atoi( argv[3]) : 4, partitions))
+    {
+      std::cerr << "Could not read " << argv[2] << std::endl;
+      return 1;
+    }
+    std::vector<Transport*> workers;
+    if ( !spawnLocalWorkers( partitions.size(), workers))
+    {
+      std::cerr << "Could not start the local workers." << std::endl;
+      waitForLocalWorkers( workers);
+      return 1;
+    }
+    bool finished = distributedRun( partitions, workers);
+    waitForLocalWorkers( workers);
+    return finished ? 0 : 1;
+  }
+  
+  if ( argc > 4 && std::string( argv[1]) == "--coordinator")
+  {
+    //One file per worker when there are as many files as workers, else the first file is split.
+    //The paths must be readable on the workers' machines.
+    int numWorkers = std::atoi( argv[3]);
+    std::vector<EdgePartition> partitions;
+    if ( argc - 4 == numWorkers)
+      for (int w = 0; w < numWorkers; ++w)
+      {
+	EdgePartition partition = { argv[4 + w], 0, -1 };
+	partitions.push_back( partition);
+      }
+    else if ( !splitEdgeFile( argv[4], numWorkers, partitions))
+    {
+      std::cerr << "Could not read " << argv[4] << std::endl;
+      return 1;
+    }
+    int listenFd = SocketTransport::listenTcp( std::atoi( argv[2]));
+    if ( listenFd < 0)
+    {
+      std::cerr << "Could not listen on port " << argv[2] << std::endl;
+      return 1;
+    }
+    std::vector<Transport*> workers;
+    for (int w = 0; w < numWorkers; ++w)
+    {
+      SocketTransport* worker = SocketTransport::acceptTcp( listenFd);
+      if ( worker == NULL)
+      {
+	std::cerr << "Could not accept worker " << w << std::endl;
+	close( listenFd);
+	waitForLocalWorkers( workers);
+	return 1;
+      }
+      workers.push_back( worker);
+    }
+    close( listenFd);
+    bool finished = distributedRun( partitions, workers);
+    waitForLocalWorkers( workers);
+    return finished ? 0 : 1;
+  }
+  
+  if ( argc > 2 && std::string( argv[1]) == "--load")
+  {
+    int numThreads = std::thread::hardware_concurrency();
+    loadBenchmark( argv[2], argc > 3 ? std::atoi( argv[3]) : (numThreads > 1 ? numThreads - 1 : 1));
+    return 0;
+  }
+  
+  if ( argc > 2 && std::string( argv[1]) == "--geometric")
+  {
+    geometricBenchmark( std::atoi( argv[2]), argc > 3 ? std::atoi( argv[3]) : 2);
+    return 0;
+  }
+  
   Graph graph( numNodes);
-  Graph graph2( numNodes);
 
   begin = clock();
   createGraph( graph);
-  graph2 = graph;
   
   end = clock();
   time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
   
   std::cout << "Init took: " << time_spent << " seconds." << std::endl;
   
+  if ( argc > 1 && std::string( argv[1]) == "--compressed")
+  {
+    //Encoded list by list and before Kruskal's copy exists, so the boost graph is the only full copy
+    CompressedGraph compressed( graph);
+    std::cout << "Compressed graph uses " << compressed.memoryBytes() << " bytes." << std::endl;
+    graph.clear();
+    
+    begin = clock();
+    kktMST(compressed);
+    end = clock();
+    time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
+    
+    std::cout << "Compressed KKT MST took: " << time_spent << " seconds." << std::endl;
+    return 0;
+  }
+  
+  Graph graph2( graph);
 
   begin = clock();
   std::vector < edge_descriptor > spanning_tree;
@@ -108,90 +270,337 @@ int main( int argc, char* argv[])
   
   std::cout << "Kruskal MST took: " << time_spent << " seconds." << std::endl;
   
-  kktMST(graph);
+  if ( argc > 2 && std::string( argv[1]) == "--save")
+  {
+    //Writes the random graph in the format PipelinedLoader reads
+    std::FILE* file = std::fopen( argv[2], "w");
+    if ( file == NULL)
+    {
+      std::cerr << "Could not write " << argv[2] << std::endl;
+      return 1;
+    }
+    EdgeWeightMap weightMap = boost::get(boost::edge_weight_t(), graph);
+    edge_iterator edgeBegin, edgeEnd;
+    for ( boost::tie( edgeBegin, edgeEnd) = boost::edges( graph); edgeBegin != edgeEnd; ++edgeBegin)
+      std::fprintf( file, "%d %d %d\n", (int)source(*edgeBegin, graph), (int)target(*edgeBegin, graph),
+		    boost::get(weightMap, *edgeBegin));
+    std::fclose( file);
+    return 0;
+  }
+  
+  if ( argc > 1 && std::string( argv[1]) == "--memory")
+  {
+    int numThreads = std::thread::hardware_concurrency();
+    MemoryPolicy policy = { transparentHugePages, interleaveNodes, numThreads > 0 ? numThreads : 1 };
+    for (int i = 2; i < argc; ++i)
+    {
+      std::string option = argv[i];
+      if ( option == "explicit") policy.pages = explicitHugePages;
+      else if ( option == "thp") policy.pages = transparentHugePages;
+      else if ( option == "small") policy.pages = smallPages;
+      else if ( option == "interleave") policy.placement = interleaveNodes;
+      else if ( option == "partition") policy.placement = partitionNodes;
+      else if ( option == "local") policy.placement = firstTouch;
+    }
+    memoryBenchmark( graph, policy);
+    return 0;
+  }
+  
+  if ( argc > 1 && std::string( argv[1]) == "--filter-kruskal")
+  {
+    //Wall clock, since the filtering and sorting run on several threads
+    int numThreads = argc > 2 ? std::atoi( argv[2]) : std::thread::hardware_concurrency();
+    if ( numThreads < 1) numThreads = 1;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Graph forest = kktMST( graph, filterKruskalEngine, numThreads);
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+    std::cout << "Filter-Kruskal MST took: " << seconds << " seconds on " << numThreads << " threads, "
+	      << boost::num_edges(forest) << " edges in the forest." << std::endl;
+  }
+  
+  begin = clock();
+  std::vector<int> components;
+  Graph forest = kktMSF(graph, components);
+  end = clock();
+  time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
+  
+  std::cout << "KKT MST took: " << time_spent << " seconds, " << boost::num_edges(forest)
+	    << " edges in the forest, " << boost::num_vertices(graph) - boost::num_edges(forest)
+	    << " components." << std::endl;
   
   graph.clear();
   return 0;
 }
 
-Graph kktMST( Graph& graph)
+Graph kktMST( Graph& graph, MSTEngine engine, int numThreads)
 {
-  std::srand (time(NULL)); //initialize the random seed.
+  std::vector<int> components;
+  return kktMSF( graph, components, engine, numThreads);
+}
+
+Graph kktMSF( Graph& graph, std::vector<int>& components, MSTEngine engine, int numThreads)
+{
+  int numVertices = boost::num_vertices( graph);
+  EdgeWeightMap weightMap = boost::get(boost::edge_weight_t(), graph);
+  EdgeList edges;
+  edge_iterator edgeBegin, edgeEnd;
   
-  if ( boost::num_edges( graph) > 1)
+  edges.reserve( boost::num_edges( graph));
+  for ( boost::tie( edgeBegin, edgeEnd) = boost::edges( graph); edgeBegin != edgeEnd; ++edgeBegin)
   {
-    Graph graphTemp( boost::num_vertices( graph));
-    
-    BoruvkaTree boruvkaTree = BoruvkaTree( boost::num_vertices( graph), supervertex_map);
-    edge_iterator edgeBegin, edgeEnd, nextEdge;
-    
-    graphTemp = boruvkaCut( graph, 0, boruvkaTree);
-    
-    Graph graph2( boost::num_vertices( graphTemp));
-    graph2 = boruvkaCut( graphTemp, 1, boruvkaTree );
-    
-    //Iterate over edges removing w/ Pr[1/2]
-    boost::tie( edgeBegin, edgeEnd) = boost::edges( graph2);
-    for (nextEdge = edgeBegin; edgeBegin != edgeEnd; edgeBegin = nextEdge)
+    WeightedEdge edge = { (int)source(*edgeBegin, graph), (int)target(*edgeBegin, graph),
+			  boost::get(weightMap, *edgeBegin), (int)edges.size() };
+    edges.push_back( edge);
+  }
+  EdgeList input = edges; //kktForest consumes its edge list
+  
+  std::vector<int> forestIds;
+  if ( engine == filterKruskalEngine)
+    filterKruskal( numVertices, edges, forestIds, numThreads);
+  else
+    kktForest( numVertices, edges, forestIds);
+  
+  if ( rank.size() < (size_t)numVertices)
+  {
+    rank.assign( numVertices);
+    parent.assign( numVertices);
+    dset = boost::disjoint_sets< Rank, Parent>( &rank[0], &parent[0]);
+  }
+  for (int v = 0; v < numVertices; ++v)
+    dset.make_set(v);
+  
+  Graph forest( numVertices);
+  for (size_t i = 0; i < forestIds.size(); ++i)
+  {
+    WeightedEdge& edge = input[forestIds[i]];
+    boost::add_edge( edge.source, edge.target, edge_weight( edge.weight), forest);
+    dset.union_set( edge.source, edge.target);
+  }
+  
+  //Number the components in order of their lowest vertex
+  std::vector<int> rootLabel( numVertices, -1);
+  int numComponents = 0;
+  components.resize( numVertices);
+  for (int v = 0; v < numVertices; ++v)
+  {
+    int root = dset.find_set(v);
+    if ( rootLabel[root] == -1)
+      rootLabel[root] = numComponents++;
+    components[v] = rootLabel[root];
+  }
+  return forest;
+}
+
+Graph kktMST( CompressedGraph& graph)
+{
+  std::vector<int> forestIds;
+  CompressedGraph graphTemp = boruvkaCut( graph, forestIds);
+  CompressedGraph graph2 = boruvkaCut( graphTemp, forestIds);
+  
+  //Only the contracted graph is ever expanded
+  EdgeList edges = graph2.edgeList();
+  kktForest( graph2.numVertices(), edges, forestIds);
+  
+  int maxId = -1;
+  for (size_t i = 0; i < forestIds.size(); ++i)
+    maxId = std::max( maxId, forestIds[i]);
+  std::vector<bool> inForest( maxId + 1, false);
+  for (size_t i = 0; i < forestIds.size(); ++i)
+    inForest[forestIds[i]] = true;
+  
+  //One more decoding pass picks the forest edges out of the input
+  Graph forest( graph.numVertices());
+  WeightedEdge edge;
+  for (int v = 0; v < graph.numVertices(); ++v)
+  {
+    CompressedGraph::NeighborCursor cursor = graph.neighbors(v);
+    while ( cursor.next(edge))
     {
-      if( std::rand() % 10 / 10 > .5)
-      {
-      	++nextEdge;
-	      boost::remove_edge( *edgeBegin , graph2);
-      }
+      if ( edge.source < edge.target && edge.id <= maxId && inForest[edge.id])
+	boost::add_edge( edge.source, edge.target, edge_weight( edge.weight), forest);
     }
+  }
+  return forest;
+}
+
+Graph kktMST( PipelinedLoader& loader)
+{
+  int numVertices = loader.numVertices();
+  const LargeArray<WeightedEdge>& candidate_edges = loader.getCandidates();
   
-    Graph graph3( boost::num_vertices(graph2));
-    
-    //First recursive call
-    graph3 = kktMST( graph2);
-    
-    //Setup vectors for the verifier according to Hagerup paper
-    EdgeWeightMap weightMap = boost::get(boost::edge_weight_t(), graph3);
-    std::vector<int> weight, upper, lower;
-    boost::tie( edgeBegin, edgeEnd) = boost::edges( graph3);
-    for (nextEdge = edgeBegin; edgeBegin != edgeEnd; ++edgeBegin)
+  //The loader's candidates are the first Boruvka step's picks
+  LargeArray<vertices_size_type> localRank( numVertices + 1);
+  LargeArray<vertex_descriptor> localParent( numVertices + 1);
+  boost::disjoint_sets< Rank, Parent> supervertices( &localRank[0], &localParent[0]);
+  std::vector<int> picked;
+  linkCandidates( numVertices, candidate_edges.data(), supervertices, picked);
+  
+  //The edges are taken out of the loader chunk by chunk, so they are never held
+  //twice. Edges inside a supervertex are dropped on the way; the rest are
+  //renumbered in input order, which keeps their weight ties ordered as before,
+  //and only their original ends and weights are kept for the forest.
+  EdgeList edges;
+  std::vector<WeightedEdge> chunk;
+  std::vector<int> original;
+  edges.reserve( loader.numEdges());
+  original.reserve( 3*(size_t)loader.numEdges());
+  while ( loader.takeChunk( chunk))
+  {
+    for (size_t i = 0; i < chunk.size(); ++i)
     {
-      int edgeWeight = boost::get(weightMap, *edgeBegin);
-      
-      weight.push_back( edgeWeight );
-      upper.push_back(source(*edgeBegin, graph3));
-      lower.push_back(target(*edgeBegin, graph3));
+      WeightedEdge edge = chunk[i];
+      edge.source = supervertices.find_set( chunk[i].source);
+      edge.target = supervertices.find_set( chunk[i].target);
+      if ( edge.source == edge.target)
+	continue;
+      original.push_back( chunk[i].source);
+      original.push_back( chunk[i].target);
+      original.push_back( chunk[i].weight);
+      edge.id = edges.size();
+      edges.push_back( edge);
     }
-    
-    MSTVerifier verify = MSTVerifier(boruvkaTree, weight, upper, lower);  
-    std::vector<int> fHeavy = verify.treePathMaxima();
-    
-    //iterate over edges and remove F-heavy edges
-    boost::tie( edgeBegin, edgeEnd) = boost::edges( graph3);
-    int fHeavyCount = 0;
-    for (nextEdge = edgeBegin; edgeBegin != edgeEnd; edgeBegin = nextEdge)
+  }
+  std::vector<WeightedEdge>().swap( chunk);
+  
+  std::vector<int> forestIds;
+  kktForest( compactEdges( numVertices, edges), edges, forestIds);
+  
+  Graph forest( numVertices);
+  for (size_t i = 0; i < picked.size(); ++i)
+  {
+    const WeightedEdge& edge = candidate_edges[picked[i]];
+    boost::add_edge( edge.source, edge.target, edge_weight( edge.weight), forest);
+  }
+  for (size_t i = 0; i < forestIds.size(); ++i)
+  {
+    const int* edge = &original[3*(size_t)forestIds[i]];
+    boost::add_edge( edge[0], edge[1], edge_weight( edge[2]), forest);
+  }
+  return forest;
+}
+
+void kktForest( int numVertices, EdgeList& edges, std::vector<int>& forest)
+{
+  if ( edges.empty()) //Every component has been condensed to one node
+    return;
+  
+  numVertices = boruvkaStep( numVertices, edges, forest);
+  numVertices = boruvkaStep( numVertices, edges, forest);
+  if ( edges.empty())
+    return;
+  
+  //Keep each edge w/ Pr[1/2]. Sample ids index into edges.
+  EdgeList sample;
+  for (size_t i = 0; i < edges.size(); ++i)
+  {
+    if ( std::rand() % 2 == 0)
     {
-      ++nextEdge;
-      if ( fHeavy[fHeavyCount] < boost::get(weightMap, *edgeBegin) )
-	      boost::remove_edge( *edgeBegin , graph3);
-      ++fHeavyCount;
+      WeightedEdge edge = edges[i];
+      edge.id = i;
+      sample.push_back( edge);
     }
-    
-    //Second recursive call
-    Graph graph4 ( boost::num_vertices( graph3));
-    graph4 = kktMST(graph3);
-    
-    graph3.clear();
-    graph2.clear();
-    
-    return graph4;
   }
-  else //The graph has been condensed to one node
+  
+  //First recursive call
+  std::vector<int> sampleForest;
+  kktForest( numVertices, sample, sampleForest);
+  EdgeList().swap( sample);
+  
+  //Path maxima in the sample's forest F come from its Boruvka tree
+  std::vector<int> heaviest;
   {
-    return graph;
+    std::vector<WeightedEdge> forestEdges;
+    for (size_t i = 0; i < sampleForest.size(); ++i)
+      forestEdges.push_back( edges[sampleForest[i]]);
+    std::vector<int> parents, weights;
+    boruvkaHierarchy( numVertices, forestEdges, parents, weights);
+    forestPathMaxima( parents, weights, edges, heaviest);
   }
+  const int noPath = (std::numeric_limits<int>::min)();
+  
+  //Remove F-heavy edges. Edges between different trees of F are F-light.
+  //Light edges keep their ids, so edges can go before the second call.
+  EdgeList light;
+  for (size_t i = 0; i < edges.size(); ++i)
+  {
+    if ( heaviest[i] == noPath || edges[i].weight <= heaviest[i])
+      light.push_back( edges[i]);
+  }
+  std::vector<int>().swap( heaviest);
+  EdgeList().swap( edges);
+  
+  //Second recursive call
+  kktForest( numVertices, light, forest);
 }
 
-void createGraph( Graph& graph)
+void batchBenchmark( int numGraphs, int graphSize)
 {
-  std::srand (time(NULL)); //initialize the random seed.
+  typedef std::chrono::steady_clock wall_clock;
   
+  GraphBatch batch;
+  batch.reserve( numGraphs, 3*numGraphs*graphSize);
+  std::vector<int> source( 3*graphSize), target( 3*graphSize), weight( 3*graphSize);
+  for (int g = 0; g < numGraphs; ++g)
+  {
+    for (int i = 0; i < 3*graphSize; ++i)
+    {
+      source[i] = std::rand() % graphSize;
+      target[i] = std::rand() % graphSize;
+      weight[i] = std::rand() % 50;
+    }
+    batch.addGraph( graphSize, source, target, weight);
+  }
+  
+  int numThreads = std::thread::hardware_concurrency();
+  BatchMST batchMST( numThreads > 0 ? numThreads : 1);
+  wall_clock::time_point begin = wall_clock::now();
+  batchMST.run( batch);
+  double seconds = std::chrono::duration<double>( wall_clock::now() - begin).count();
+  std::cout << "Batch MST: " << numGraphs / seconds << " graphs per second on "
+	    << numThreads << " threads." << std::endl;
+  
+  //One graph at a time through kktMST, on a sample of the batch
+  int sampled = std::min( numGraphs, 1000);
+  const std::vector<WeightedEdge>& edges = batch.getEdges();
+  begin = wall_clock::now();
+  for (int g = 0; g < sampled; ++g)
+  {
+    int base = batch.getVertexOffset()[g];
+    Graph graph( graphSize);
+    for (int i = batch.getEdgeOffset()[g]; i < batch.getEdgeOffset()[g + 1]; ++i)
+      boost::add_edge( edges[i].source - base, edges[i].target - base, edge_weight( edges[i].weight), graph);
+    kktMST( graph);
+  }
+  seconds = std::chrono::duration<double>( wall_clock::now() - begin).count();
+  std::cout << "kktMST per graph: " << sampled / seconds << " graphs per second." << std::endl;
+}
+
+bool distributedRun( const std::vector<EdgePartition>& partitions, std::vector<Transport*>& workers)
+{
+  typedef std::chrono::steady_clock wall_clock;
+  DistributedReport report;
+  std::vector<int> components;
+  Graph forest;
+  
+  wall_clock::time_point begin = wall_clock::now();
+  if ( !distributedMST( partitions, workers, forest, components, report))
+  {
+    std::cerr << "Distributed MST failed." << std::endl;
+    return false;
+  }
+  double seconds = std::chrono::duration<double>( wall_clock::now() - begin).count();
+  
+  std::cout << "Distributed MST on " << workers.size() << " workers took: " << seconds << " seconds, "
+	    << boost::num_edges(forest) << " edges in the forest, " << report.survivingEdges
+	    << " edges survived local filtering." << std::endl;
+  for (size_t round = 0; round < report.bytesPerRound.size(); ++round)
+    std::cout << "  round " << round + 1 << " (" << report.roundNames[round] << "): "
+	      << report.bytesPerRound[round] << " bytes" << std::endl;
+  return true;
+}
+
+void createGraph( Graph& graph)
+{
   vertex_iterator vertexBegin, vertexEnd;
   vertex_iterator vertexBegin1, vertexEnd1;
   
@@ -200,215 +609,742 @@ void createGraph( Graph& graph)
   
   for( ; vertexBegin != vertexEnd; ++vertexBegin)
   {
+    dset.make_set( vertex(*vertexBegin, graph)); //Creates a disjoint set for the vertex, even if it stays isolated
     for( ; vertexBegin1 != vertexEnd1; ++vertexBegin1)
     {
       if( std::rand() >= RAND_MAX/(numNodes/10) && *vertexBegin != *vertexBegin1)
       {
       	edge_weight ewp = std::rand()%50; //assigns each edge an integer weight between 0 and 50
       	add_edge( *vertexBegin, *vertexBegin1, ewp, graph); //Adds edge to graph
-      	dset.make_set( vertex(*vertexBegin, graph)); //Creates a disjoint set for the vertex
-      	supervertex_map[*vertexBegin] = vertex(*vertexBegin,graph);
       }
     }
   }
 }
 
-Graph boruvkaCut( Graph& graph, int createTree, BoruvkaTree& boruvkaTree)
-{ 
-  if (createTree == 0) //first cut, don't need to create tree
+/**
+ * Relabels the supervertices that still have edges to 0 .. k-1, drops self
+ * loops and keeps the lightest of any parallel edges. Edges are bucketed by
+ * source, so this is linear rather than a sort. Returns k.
+ */
+static int compactEdges( int numVertices, EdgeList& edges)
+{
+  LargeArray<int> label( numVertices, -1);
+  int numSupervertices = 0;
+  size_t kept = 0;
+  for (size_t i = 0; i < edges.size(); ++i)
   {
-    EdgeWeightMap weight = boost::get(boost::edge_weight_t(), graph);
-    vertex_iterator vertexBegin, vertexEnd;
-    edge_iterator edgeBegin, edgeEnd;
-    edge_descriptor minWeightEdge;
-    Graph graph2(boost::num_vertices(graph));
-    
-    const int infinity = (std::numeric_limits<int>::max)();
-    std::vector<w_edge> candidate_edges( supervertices.size());
-    
-    boost::tie( edgeBegin, edgeEnd) = boost::edges( graph);
-    
-    for (; edgeBegin != edgeEnd; ++edgeBegin)
+    WeightedEdge edge = edges[i];
+    if ( edge.source == edge.target)
+      continue;
+    if ( edge.source > edge.target)
+      std::swap( edge.source, edge.target);
+    if ( label[edge.source] == -1) label[edge.source] = numSupervertices++;
+    if ( label[edge.target] == -1) label[edge.target] = numSupervertices++;
+    edge.source = label[edge.source];
+    edge.target = label[edge.target];
+    edges[kept++] = edge;
+  }
+  edges.resize( kept);
+  
+  std::vector<int> start( numSupervertices + 1, 0);
+  for (size_t i = 0; i < edges.size(); ++i)
+    ++start[edges[i].source + 1];
+  for (int v = 0; v < numSupervertices; ++v)
+    start[v + 1] += start[v];
+  LargeArray<WeightedEdge> bucketed( edges.size());
+  std::vector<int> fill( start.begin(), start.end() - 1);
+  for (size_t i = 0; i < edges.size(); ++i)
+    bucketed[fill[edges[i].source]++] = edges[i];
+  
+  LargeArray<int> seenFrom( numSupervertices, -1), seenAt( numSupervertices, 0);
+  edges.clear();
+  for (int v = 0; v < numSupervertices; ++v)
+  {
+    for (int i = start[v]; i < start[v + 1]; ++i)
     {
-      std::pair<edge_descriptor, int> insertEdge = w_edge( *edgeBegin, infinity);
-      candidate_edges.push_back( insertEdge);
+      WeightedEdge& edge = bucketed[i];
+      if ( seenFrom[edge.target] == v)
+      {
+	edges[seenAt[edge.target]] = findMinWeightEdge( edges[seenAt[edge.target]], edge);
+      }
+      else
+      {
+	seenFrom[edge.target] = v;
+	seenAt[edge.target] = edges.size();
+	edges.push_back( edge);
+      }
     }
+  }
+  return numSupervertices;
+}
 
-    
-    boost::tie( edgeBegin, edgeEnd) = boost::edges( graph);
-    
-    for (; edgeBegin != edgeEnd; ++edgeBegin)
+/**
+ * Starts every vertex as a supervertex of its own, then links supervertices
+ * along every vertex's candidate edge, skipping the ones that would close a
+ * cycle. The vertices whose candidate was used are appended to picked.
+ */
+static void linkCandidates( int numVertices, const WeightedEdge* candidate_edges,
+			    boost::disjoint_sets< Rank, Parent>& supervertices, std::vector<int>& picked)
+{
+  for (int v = 0; v < numVertices; ++v)
+    supervertices.make_set(v);
+  
+  for (int i = 0; i < numVertices; ++i)
+  {
+    if (candidate_edges[i].source != -1)
     {
-      int w = boost::get(weight, *edgeBegin);
-      int u = supervertex_map[dset.find_set(source(*edgeBegin, graph))];
-      int v = supervertex_map[dset.find_set(target(*edgeBegin, graph))];
-
+      vertex_descriptor u = supervertices.find_set( candidate_edges[i].source);
+      vertex_descriptor v = supervertices.find_set( candidate_edges[i].target);
       if (u != v)
       {
-      	candidate_edges[u] = findMinWeightEdge( candidate_edges[u], w_edge( *edgeBegin, w));
-      	candidate_edges[v] = findMinWeightEdge( candidate_edges[v], w_edge( *edgeBegin, w));
+	// Link the two supervertices
+	supervertices.link(u, v);
+	picked.push_back(i);
       }
     }
-    
-    for (int i = 0; i < candidate_edges.size(); ++i)
+  }
+}
+
+int boruvkaStep( int numVertices, EdgeList& edges, std::vector<int>& forest)
+{
+  const int infinity = (std::numeric_limits<int>::max)();
+  const WeightedEdge noEdge = { -1, -1, infinity, infinity };
+  LargeArray<WeightedEdge> candidate_edges( numVertices, noEdge);
+  
+  for (size_t i = 0; i < edges.size(); ++i)
+  {
+    candidate_edges[edges[i].source] = findMinWeightEdge( candidate_edges[edges[i].source], edges[i]);
+    candidate_edges[edges[i].target] = findMinWeightEdge( candidate_edges[edges[i].target], edges[i]);
+  }
+  
+  LargeArray<vertices_size_type> localRank( numVertices + 1);
+  LargeArray<vertex_descriptor> localParent( numVertices + 1);
+  boost::disjoint_sets< Rank, Parent> supervertices( &localRank[0], &localParent[0]);
+  std::vector<int> picked;
+  linkCandidates( numVertices, candidate_edges.data(), supervertices, picked);
+  for (size_t i = 0; i < picked.size(); ++i)
+    forest.push_back( candidate_edges[picked[i]].id);
+  
+  for (size_t i = 0; i < edges.size(); ++i)
+  {
+    edges[i].source = supervertices.find_set( edges[i].source);
+    edges[i].target = supervertices.find_set( edges[i].target);
+  }
+  return compactEdges( numVertices, edges);
+}
+
+CompressedGraph boruvkaCut( CompressedGraph& graph, std::vector<int>& forest)
+{
+  const int infinity = (std::numeric_limits<int>::max)();
+  const WeightedEdge noEdge = { -1, -1, infinity, infinity };
+  int numVertices = graph.numVertices();
+  LargeArray<WeightedEdge> candidate_edges( numVertices, noEdge);
+  WeightedEdge edge;
+  
+  //Every edge is stored in both endpoint lists, so each vertex only has to
+  //look at its own side.
+  for (int v = 0; v < numVertices; ++v)
+  {
+    CompressedGraph::NeighborCursor cursor = graph.neighbors(v);
+    while ( cursor.next(edge))
+      candidate_edges[v] = findMinWeightEdge( candidate_edges[v], edge);
+  }
+  
+  LargeArray<vertices_size_type> localRank( numVertices + 1);
+  LargeArray<vertex_descriptor> localParent( numVertices + 1);
+  boost::disjoint_sets< Rank, Parent> supervertices( &localRank[0], &localParent[0]);
+  std::vector<int> picked;
+  linkCandidates( numVertices, candidate_edges.data(), supervertices, picked);
+  for (size_t i = 0; i < picked.size(); ++i)
+    forest.push_back( candidate_edges[picked[i]].id);
+  std::vector<int>().swap( picked);
+  
+  //Number the supervertices that keep an edge; one decoding pass finds them
+  LargeArray<int> label( numVertices, -1);
+  for (int v = 0; v < numVertices; ++v)
+  {
+    int u = supervertices.find_set(v);
+    if ( label[u] != -1 || graph.degree(v) == 0)
+      continue;
+    CompressedGraph::NeighborCursor cursor = graph.neighbors(v);
+    while ( cursor.next(edge))
     {
-      if (candidate_edges[i].second != infinity)
+      if ( supervertices.find_set(edge.target) != u)
       {
-      	edge_descriptor e = candidate_edges[i].first;
-      	vertex_descriptor u = dset.find_set( source(e, graph));
-      	vertex_descriptor v = dset.find_set( target(e, graph));
-      	if (u != v)
-      	{
-      	  // Link the two supervertices
-      	  dset.link(u, v);
-      
-      	  // Whichever vertex was reparented will be removed from the
-      	  // list of supervertices.
-      	  vertex_descriptor victim = u;
-      	  vertex_descriptor findU = dset.find_set(u);
-      	  if ( findU == u)
-      	      victim = v;
-      	  if ( &supervertex_map[victim] != NULL)
-      	    supervertices[supervertex_map[victim]] = boost::graph_traits<Graph>::null_vertex();
-      	}
+	label[u] = 0;
+	break;
       }
     }
-    //given a vector of vertices from supervertices, form graph.
-    for( std::vector<vertex_descriptor>::iterator vertexBegin = supervertices.begin();
-  	     vertexBegin != supervertices.end(); ++vertexBegin)
-  	{
-  	  vertex_descriptor v = add_vertex(graph2);
-  	  v = *vertexBegin;
-  	}
-  	
-
-  	vertex_iterator vertexBeginGraph2, vertexEndGraph2;  
-      for( boost::tie(vertexBeginGraph2, vertexEndGraph2) = boost::vertices(graph2); vertexBeginGraph2 != vertexEndGraph2; ++vertexBeginGraph2)
-  	{
-  	  out_edge_iterator outEdgeBegin, outEdgeEnd;
-  	  vertex_descriptor v = *vertexBeginGraph2;
-  	  boost::tie(outEdgeBegin, outEdgeEnd) = out_edges(v, graph);
-  	  for ( ; outEdgeBegin != outEdgeEnd; ++outEdgeBegin)
-  	  {
-  	    vertex_descriptor outVertex = dset.find_set( target( *outEdgeBegin, graph));
-  	    if ( outVertex != v)
-  	    {
-  		boost::add_edge(v, outVertex, boost::get(weight, *outEdgeBegin), graph2);
-  	    }
-  	  }
-  	}
-    supervertices.erase( std::remove( supervertices.begin(), supervertices.end(),
-				      boost::graph_traits<Graph>::null_vertex()), supervertices.end());
-    return graph2;
-  }
-  else //Create the boruvka tree in this step
-  {
-    vertex_iterator vertexBegin, vertexEnd;
-    std::vector<vertex_descriptor> vertexDescriptors;
-    std::map<vertex_descriptor, std::list<vertex_descriptor> > parentMap;
-    
-    EdgeWeightMap weight = boost::get(boost::edge_weight_t(), graph);
-    edge_iterator edgeBegin, edgeEnd;
-    edge_descriptor minWeightEdge;
-    Graph graph2;
-    
-    boost::tie( vertexBegin, vertexEnd) = boost::vertices( graph);
-    
-    for (; vertexBegin != vertexEnd; ++vertexBegin)
+  }
+  int numSupervertices = 0;
+  for (int u = 0; u < numVertices; ++u)
+    if ( label[u] != -1)
+      label[u] = numSupervertices++;
+  
+  //Bucket the vertices by supervertex, so each contracted list can be
+  //gathered from its members and encoded straight away
+  LargeArray<int> superOf( numVertices);
+  std::vector<int> start( numSupervertices + 1, 0);
+  for (int v = 0; v < numVertices; ++v)
+  {
+    superOf[v] = label[supervertices.find_set(v)];
+    if ( superOf[v] != -1)
+      ++start[superOf[v] + 1];
+  }
+  for (int u = 0; u < numSupervertices; ++u)
+    start[u + 1] += start[u];
+  LargeArray<int> members( start[numSupervertices]);
+  std::vector<int> fill( start.begin(), start.end() - 1);
+  for (int v = 0; v < numVertices; ++v)
+    if ( superOf[v] != -1)
+      members[fill[superOf[v]]++] = v;
+  
+  //Only the lightest of any parallel edges goes into a list
+  CompressedGraph::Builder builder( numSupervertices, graph);
+  LargeArray<int> seenAt( numSupervertices, -1);
+  std::vector<WeightedEdge> list;
+  for (int u = 0; u < numSupervertices; ++u)
+  {
+    list.clear();
+    for (int i = start[u]; i < start[u + 1]; ++i)
     {
-      vertexDescriptors.push_back(*vertexBegin);
+      CompressedGraph::NeighborCursor cursor = graph.neighbors( members[i]);
+      while ( cursor.next(edge))
+      {
+	int t = superOf[edge.target];
+	if ( t == u)
+	  continue;
+	edge.source = u;
+	edge.target = t;
+	if ( seenAt[t] == -1)
+	{
+	  seenAt[t] = list.size();
+	  list.push_back( edge);
+	}
+	else
+	  list[seenAt[t]] = findMinWeightEdge( list[seenAt[t]], edge);
+      }
     }
-    boruvkaTree.create(vertexDescriptors);
-    
-    const int infinity = (std::numeric_limits<int>::max)();
-    std::vector<w_edge> candidate_edges( supervertices.size());
-    
-    boost::tie( edgeBegin, edgeEnd) = boost::edges( graph);
-    
-    for (; edgeBegin != edgeEnd; ++edgeBegin)
+    for (size_t i = 0; i < list.size(); ++i)
+      seenAt[list[i].target] = -1;
+    builder.addList( list);
+  }
+  return builder.finish();
+}
+
+void boruvkaHierarchy( int numVertices, std::vector<WeightedEdge> edges, std::vector<int>& parents,
+		       std::vector<int>& weights)
+{
+  const int infinity = (std::numeric_limits<int>::max)();
+  const WeightedEdge noEdge = { -1, -1, infinity, infinity };
+  parents.assign( numVertices, -1);
+  weights.assign( numVertices, -1);
+  
+  //nodeOf[v] is the tree node standing for supervertex v
+  std::vector<int> nodeOf( numVertices);
+  for (int v = 0; v < numVertices; ++v)
+    nodeOf[v] = v;
+  
+  while ( !edges.empty())
+  {
+    LargeArray<WeightedEdge> candidate_edges( numVertices, noEdge);
+    for (size_t i = 0; i < edges.size(); ++i)
     {
-      std::pair<edge_descriptor, int> insertEdge = w_edge( *edgeBegin, infinity);
-      candidate_edges.push_back( insertEdge);
+      candidate_edges[edges[i].source] = findMinWeightEdge( candidate_edges[edges[i].source], edges[i]);
+      candidate_edges[edges[i].target] = findMinWeightEdge( candidate_edges[edges[i].target], edges[i]);
     }
     
-    boost::tie( edgeBegin, edgeEnd) = boost::edges( graph);
+    LargeArray<vertices_size_type> localRank( numVertices + 1);
+    LargeArray<vertex_descriptor> localParent( numVertices + 1);
+    boost::disjoint_sets< Rank, Parent> supervertices( &localRank[0], &localParent[0]);
+    for (int v = 0; v < numVertices; ++v)
+      supervertices.make_set(v);
+    for (int v = 0; v < numVertices; ++v)
+    {
+      if ( candidate_edges[v].source != -1)
+	supervertices.union_set( candidate_edges[v].source, candidate_edges[v].target);
+    }
     
-    for (; edgeBegin != edgeEnd; ++edgeBegin)
+    //Every supervertex that picked an edge becomes a child of its new
+    //supervertex; ones without edges are finished roots.
+    std::vector<int> label( numVertices, -1), nextNodeOf;
+    int numSupervertices = 0;
+    for (int v = 0; v < numVertices; ++v)
     {
-      int w = boost::get(weight, *edgeBegin);
-      int u = supervertex_map[dset.find_set(source(*edgeBegin, graph))];
-      int v = supervertex_map[dset.find_set(target(*edgeBegin, graph))];
-
-      if (u != v)
+      if ( candidate_edges[v].source == -1)
+	continue;
+      int root = supervertices.find_set(v);
+      if ( label[root] == -1)
       {
-      	candidate_edges[u] = findMinWeightEdge( candidate_edges[u], w_edge( *edgeBegin, w));
-      	candidate_edges[v] = findMinWeightEdge( candidate_edges[v], w_edge( *edgeBegin, w));
+	label[root] = numSupervertices++;
+	nextNodeOf.push_back( parents.size());
+	parents.push_back(-1);
+	weights.push_back(-1);
       }
+      parents[nodeOf[v]] = nextNodeOf[label[root]];
+      weights[nodeOf[v]] = candidate_edges[v].weight;
     }
     
-    for (int i = 0; i < candidate_edges.size(); ++i)
+    //Contracting forest edges can't create parallel edges, only self loops
+    size_t kept = 0;
+    for (size_t i = 0; i < edges.size(); ++i)
     {
-      if (candidate_edges[i].second != infinity)
+      int u = label[supervertices.find_set( edges[i].source)];
+      int w = label[supervertices.find_set( edges[i].target)];
+      if ( u != w)
       {
-      	edge_descriptor e = candidate_edges[i].first;
-      	vertex_descriptor u = dset.find_set( source(e, graph));
-      	vertex_descriptor v = dset.find_set( target(e, graph));
-      	if (u != v)
-      	{
-      	   // Link the two supervertices
-      	  dset.link(u, v);
-      	  
-          //Set the parent of the linked nodes in the tree
-      	  boruvkaTree.setParent(u,v, boost::get(weight, e));
-      
-      	  // Whichever vertex was reparented will be removed from the
-          // list of supervertices.
-      	  vertex_descriptor victim = u;
-      	  vertex_descriptor findU = dset.find_set(u);
-      	  if ( findU == u)
-      	      victim = v;
-      	  if ( &supervertex_map[victim] != NULL)
-      	    supervertices[supervertex_map[victim]] = boost::graph_traits<Graph>::null_vertex();
-      	}
+	edges[kept] = edges[i];
+	edges[kept].source = u;
+	edges[kept].target = w;
+	++kept;
       }
     }
-    
- //given a vector of vertices from supervertices, form graph.
-    for( std::vector<vertex_descriptor>::iterator vertexBegin = supervertices.begin();
-	vertexBegin != supervertices.end(); ++vertexBegin)
+    edges.resize( kept);
+    nodeOf = nextNodeOf;
+    numVertices = numSupervertices;
+  }
+}
+
+namespace
+{
+  /**
+   * Path maxima between the leaves of a Boruvka tree. The tree is renumbered
+   * in preorder below an extra root that joins its trees, so the verifier sees
+   * one tree, and Tarjan's offline search finds the common ancestors: a leaf
+   * has been visited exactly when its number is below the current node's.
+   */
+  class LeafPathMaxima
+  {
+    public:
+      LeafPathMaxima( const std::vector<int>& parents, const std::vector<int>& weights);
+
+      //Answers edges[first .. last - 1] into heaviest
+      void answer( const EdgeList& edges, size_t first, size_t last, std::vector<int>& heaviest);
+      int size() const { return numNodes; }
+
+    private:
+      static const int root = 0;
+      int numNodes;
+      std::vector<int> order, child, sibling, weight;
+      //Queries of node u are queryStart[u] .. queryStart[u + 1] - 1
+      std::vector<int> queryStart, queryEdge, queryOther, lca, ancestor;
+      LargeArray<vertices_size_type> setRank;
+      LargeArray<vertex_descriptor> setParent;
+
+      void numberInPreorder( int u, int& next);
+      void visit( int u, boost::disjoint_sets< Rank, Parent>& sets);
+  };
+
+  LeafPathMaxima::LeafPathMaxima( const std::vector<int>& parents, const std::vector<int>& weights)
+    : setRank( parents.size() + 1), setParent( parents.size() + 1)
+  {
+    const int noPath = (std::numeric_limits<int>::min)();
+    numNodes = parents.size() + 1;
+    order.assign( numNodes, 0);
+    child.assign( numNodes, -1);
+    sibling.assign( numNodes, -1);
+    for (int x = numNodes - 2; x >= 0; --x)
+    {
+      int p = parents[x] >= 0 ? parents[x] : numNodes - 1;
+      sibling[x] = child[p];
+      child[p] = x;
+    }
+    int next = 0;
+    numberInPreorder( numNodes - 1, next);
+
+    child.assign( numNodes, -1);
+    sibling.assign( numNodes, -1);
+    weight.assign( numNodes, noPath);
+    for (int x = numNodes - 2; x >= 0; --x)
+    {
+      int u = order[x], p = parents[x] >= 0 ? order[parents[x]] : root;
+      sibling[u] = child[p];
+      child[p] = u;
+      if ( parents[x] >= 0)
+	weight[u] = weights[x];
+    }
+    ancestor.assign( numNodes, -1);
+  }
+
+  //The first pass labels nodes by their old numbers
+  void LeafPathMaxima::numberInPreorder( int u, int& next)
+  {
+    order[u] = next++;
+    for (int c = child[u]; c >= 0; c = sibling[c])
+      numberInPreorder( c, next);
+  }
+
+  void LeafPathMaxima::visit( int u, boost::disjoint_sets< Rank, Parent>& sets)
+  {
+    sets.make_set(u);
+    ancestor[u] = u;
+    for (int c = child[u]; c >= 0; c = sibling[c])
+    {
+      visit( c, sets);
+      sets.union_set( u, c);
+      ancestor[sets.find_set(u)] = u;
+    }
+    for (int p = queryStart[u]; p < queryStart[u + 1]; ++p)
+      lca[p] = ancestor[sets.find_set( queryOther[p])];
+  }
+
+  void LeafPathMaxima::answer( const EdgeList& edges, size_t first, size_t last,
+			       std::vector<int>& heaviest)
+  {
+    //Every edge is asked about at its later end
+    queryStart.assign( numNodes + 1, 0);
+    for (size_t i = first; i < last; ++i)
+      ++queryStart[std::max( order[edges[i].source], order[edges[i].target]) + 1];
+    for (int u = 0; u < numNodes; ++u)
+      queryStart[u + 1] += queryStart[u];
+    queryEdge.resize( last - first);
+    queryOther.resize( last - first);
+    lca.resize( last - first);
+    std::vector<int> fill( queryStart.begin(), queryStart.end() - 1);
+    for (size_t i = first; i < last; ++i)
+    {
+      int a = order[edges[i].source], b = order[edges[i].target];
+      int p = fill[std::max( a, b)]++;
+      queryEdge[p] = i;
+      queryOther[p] = std::min( a, b);
+    }
+    boost::disjoint_sets< Rank, Parent> sets( &setRank[0], &setParent[0]);
+    visit( root, sets);
+
+    //Every path is split at the common ancestor into two that only go up, the
+    //form the verifier answers, sorted by their lower end so the verifier
+    //walks its query lists in order. Loops and edges between different trees
+    //have no path to ask about.
+    std::vector<int> pathStart( numNodes + 1, 0);
+    for (int u = 0; u < numNodes; ++u)
+    {
+      for (int p = queryStart[u]; p < queryStart[u + 1]; ++p)
+      {
+	if ( lca[p] != root && queryOther[p] != u)
 	{
-	  vertex_descriptor v = add_vertex(graph2);
-	  v = *vertexBegin;
+	  ++pathStart[u + 1];
+	  ++pathStart[queryOther[p] + 1];
 	}
-	
-
-	vertex_iterator vertexBeginGraph2, vertexEndGraph2;  
-    for( boost::tie(vertexBeginGraph2, vertexEndGraph2) = boost::vertices(graph2); vertexBeginGraph2 != vertexEndGraph2; ++vertexBeginGraph2)
+      }
+    }
+    for (int u = 0; u < numNodes; ++u)
+      pathStart[u + 1] += pathStart[u];
+    std::vector<int> upper( pathStart[numNodes]), lower( pathStart[numNodes]), pathEdge( pathStart[numNodes]);
+    for (int u = 0; u < numNodes; ++u)
+    {
+      for (int p = queryStart[u]; p < queryStart[u + 1]; ++p)
+      {
+	if ( lca[p] == root || queryOther[p] == u)
+	  continue;
+	int ends[2] = { u, queryOther[p] };
+	for (int e = 0; e < 2; ++e)
 	{
-	  out_edge_iterator outEdgeBegin, outEdgeEnd;
-	  vertex_descriptor v = *vertexBeginGraph2;
-	  boost::tie(outEdgeBegin, outEdgeEnd) = out_edges(v, graph);
-	  for ( ; outEdgeBegin != outEdgeEnd; ++outEdgeBegin)
-	  {
-	    vertex_descriptor outVertex = dset.find_set( target( *outEdgeBegin, graph));
-	    if ( outVertex != v)
-	    {
-		boost::add_edge(v, outVertex, boost::get(weight, *outEdgeBegin), graph2);
-	    }
-	  }
+	  int q = pathStart[ends[e]]++;
+	  upper[q] = lca[p];
+	  lower[q] = ends[e];
+	  pathEdge[q] = queryEdge[p];
 	}
-    supervertices.erase( std::remove( supervertices.begin(), supervertices.end(),
-				      boost::graph_traits<Graph>::null_vertex()),
-			  supervertices.end());
-    return graph2;
+      }
+    }
+
+    MSTVerifier verifier( root, child, sibling, weight, upper, lower);
+    std::vector<int> maxima = verifier.treePathMaxima();
+    for (size_t q = 0; q < maxima.size(); ++q)
+      heaviest[pathEdge[q]] = std::max( heaviest[pathEdge[q]], weight[maxima[q]]);
   }
+}
+
+void forestPathMaxima( const std::vector<int>& parents, const std::vector<int>& weights,
+		       const EdgeList& edges, std::vector<int>& heaviest)
+{
+  heaviest.assign( edges.size(), (std::numeric_limits<int>::min)());
+  LeafPathMaxima tree( parents, weights);
+
+  //Every block costs a walk over the tree, so blocks a few times its size
+  //keep the time linear while the queries' memory stays proportional to
+  //the tree rather than to the edges
+  size_t blockSize = 4*(size_t)tree.size();
+  for (size_t first = 0; first < edges.size(); first += blockSize)
+    tree.answer( edges, first, std::min( edges.size(), first + blockSize), heaviest);
+}
+
+void geometricBenchmark( int numPoints, int dimension)
+{
+  typedef std::chrono::steady_clock wall_clock;
+  if ( dimension != 3) dimension = 2;
+  
+  std::vector<double> coords( (size_t)numPoints*dimension);
+  for (size_t i = 0; i < coords.size(); ++i)
+    coords[i] = (double)std::rand() / RAND_MAX;
+  
+  int numThreads = std::thread::hardware_concurrency();
+  if ( numThreads < 1) numThreads = 1;
+  wall_clock::time_point begin = wall_clock::now();
+  std::vector<WeightedEdge> candidates;
+  std::vector<double> lengths;
+  euclideanCandidates( dimension, coords, candidates, lengths, numThreads);
+  double seconds = std::chrono::duration<double>( wall_clock::now() - begin).count();
+  double total = 0;
+  for (size_t i = 0; i < lengths.size(); ++i)
+    total += lengths[i];
+  std::cout << "Candidate search took: " << seconds << " seconds on " << numThreads << " threads, "
+	    << candidates.size() << " candidates, total length " << total << "." << std::endl;
+  
+  //The candidates are already the exact Euclidean MST, so this only times
+  //kktMST on a tree; the candidate search above is the real work
+  Graph graph = candidateGraph( numPoints, candidates, lengths);
+  begin = wall_clock::now();
+  Graph tree = kktMST( graph);
+  seconds = std::chrono::duration<double>( wall_clock::now() - begin).count();
+  std::cout << "kktMST over the candidate tree took: " << seconds << " seconds, "
+	    << boost::num_edges( tree) << " edges." << std::endl;
+}
+
+void memoryBenchmark( Graph& graph, const MemoryPolicy& policy)
+{
+  typedef std::chrono::steady_clock wall_clock;
+  const char* pageNames[] = { "small pages", "transparent huge pages", "explicit huge pages" };
+  const char* placementNames[] = { "first touch", "interleaved", "partitioned" };
+  MemoryPolicy defaultPolicy = { smallPages, firstTouch, 1 };
+  MemoryPolicy policies[] = { defaultPolicy, policy };
+  double edges = boost::num_edges( graph);
   
+  std::cout << "NUMA nodes: " << numaNodes() << std::endl;
+  for (int run = 0; run < 2; ++run)
+  {
+    setMemoryPolicy( policies[run]);
+    wall_clock::time_point begin = wall_clock::now();
+    rank.assign( numNodes);
+    parent.assign( numNodes);
+    dset = boost::disjoint_sets< Rank, Parent>( &rank[0], &parent[0]);
+    double allocSeconds = std::chrono::duration<double>( wall_clock::now() - begin).count();
+    
+    begin = wall_clock::now();
+    std::vector<int> components;
+    kktMSF( graph, components);
+    double seconds = std::chrono::duration<double>( wall_clock::now() - begin).count();
+    std::cout << pageNames[policies[run].pages] << ", " << placementNames[policies[run].placement] << ", "
+	      << policies[run].numThreads << " init threads: union-find arrays took " << allocSeconds
+	      << " seconds, kktMSF " << edges / seconds << " edges per second." << std::endl;
+  }
+  setMemoryPolicy( defaultPolicy);
 }
 
+void loadBenchmark( const std::string& path, int numWorkers)
+{
+  typedef std::chrono::steady_clock wall_clock;
+  
+  PipelinedLoader loader( numWorkers);
+  wall_clock::time_point begin = wall_clock::now();
+  if ( !loader.load( path))
+  {
+    std::cerr << "Could not read " << path << std::endl;
+    return;
+  }
+  double loadSeconds = std::chrono::duration<double>( wall_clock::now() - begin).count();
+  wall_clock::time_point loaded = wall_clock::now();
+  Graph forest = kktMST( loader);
+  double mstSeconds = std::chrono::duration<double>( wall_clock::now() - loaded).count();
+  std::cout << "Pipelined: loading " << loader.numEdges() << " edges with " << numWorkers << " workers took "
+	    << loadSeconds << " seconds, kktMST after the input ended " << mstSeconds << " seconds, "
+	    << boost::num_edges( forest) << " edges in the forest." << std::endl;
+  
+  //Same input, with the first Boruvka pass left until everything is read.
+  //kktMST emptied the loader, so it reads the input again first.
+  loader.load( path);
+  begin = wall_clock::now();
+  EdgeList edges;
+  loader.copyEdges( edges);
+  std::vector<int> forestIds;
+  kktForest( loader.numVertices(), edges, forestIds);
+  Graph unpipelined( loader.numVertices());
+  for (size_t i = 0; i < forestIds.size(); ++i)
+  {
+    const WeightedEdge& edge = loader.getEdge( forestIds[i]);
+    boost::add_edge( edge.source, edge.target, edge_weight( edge.weight), unpipelined);
+  }
+  mstSeconds = std::chrono::duration<double>( wall_clock::now() - begin).count();
+  std::cout << "Load then MST: kktForest after the input ended " << mstSeconds << " seconds, "
+	    << boost::num_edges( unpipelined) << " edges in the forest." << std::endl;
+}
 
-w_edge findMinWeightEdge( w_edge edge1, w_edge edge2)
+/**
+ * Walks the forest from a few vertices, noting every vertex's parent edge and
+ * the heaviest weight on its path back, and checks that PathMaxIndex returns
+ * an edge of that weight lying on the path, or noPath where there is none.
+ */
+static bool checkPathMaxima( Graph& mst)
 {
-  if ( edge1.second < edge2.second) return edge1;
-  else return edge2;
+  int numVertices = boost::num_vertices( mst);
+  EdgeWeightMap weightMap = boost::get(boost::edge_weight_t(), mst);
+  std::vector<WeightedEdge> edges;
+  edge_iterator edgeBegin, edgeEnd;
+  for ( boost::tie( edgeBegin, edgeEnd) = boost::edges( mst); edgeBegin != edgeEnd; ++edgeBegin)
+  {
+    WeightedEdge edge = { (int)source(*edgeBegin, mst), (int)target(*edgeBegin, mst),
+			  boost::get(weightMap, *edgeBegin), (int)edges.size() };
+    edges.push_back( edge);
+  }
+  std::vector< std::vector<int> > incident( numVertices);
+  for (size_t i = 0; i < edges.size(); ++i)
+  {
+    incident[edges[i].source].push_back(i);
+    incident[edges[i].target].push_back(i);
+  }
+  
+  SingleLinkage dendrogram( mst);
+  PathMaxIndex index( dendrogram);
+  for (int walk = 0; walk < 3; ++walk)
+  {
+    int from = std::rand() % numVertices;
+    std::vector<int> parentEdge( numVertices, -1), heaviest( numVertices, 0);
+    std::vector<bool> reached( numVertices, false);
+    std::vector<int> stack( 1, from);
+    reached[from] = true;
+    while ( !stack.empty())
+    {
+      int v = stack.back();
+      stack.pop_back();
+      for (size_t i = 0; i < incident[v].size(); ++i)
+      {
+	const WeightedEdge& edge = edges[incident[v][i]];
+	int w = edge.source == v ? edge.target : edge.source;
+	if ( reached[w]) continue;
+	reached[w] = true;
+	parentEdge[w] = edge.id;
+	heaviest[w] = v == from ? edge.weight : std::max( heaviest[v], edge.weight);
+	stack.push_back(w);
+      }
+    }
+    
+    std::vector<int> u( numVertices, from), v( numVertices), answer;
+    for (int x = 0; x < numVertices; ++x)
+      v[x] = x;
+    index.query( u, v, answer, 2);
+    for (int x = 0; x < numVertices; ++x)
+    {
+      if ( x == from || !reached[x])
+      {
+	if ( answer[x] != PathMaxIndex::noPath) return false;
+	continue;
+      }
+      if ( answer[x] < 0 || answer[x] >= (int)edges.size() || edges[answer[x]].weight != heaviest[x])
+	return false;
+      int y = x;
+      while ( y != from && parentEdge[y] != answer[x])
+	y = edges[parentEdge[y]].source == y ? edges[parentEdge[y]].target : edges[parentEdge[y]].source;
+      if ( y == from) return false;
+    }
+  }
+  return true;
 }
 
+bool checkForests( int numGraphs)
+{
+  //Every graph also goes into one batch for BatchMST, checked at the end
+  GraphBatch batch;
+  std::vector<long long> batchWeight;
+  std::vector<size_t> batchSize;
+  
+  for (int g = 0; g < numGraphs; ++g)
+  {
+    int numVertices = 1 + std::rand() % 2000;
+    int numEdges = std::rand() % (3*numVertices + 1);
+    Graph graph( numVertices);
+    //Every fourth graph weighs its edges at the top of the int range, where
+    //the "no edge" sentinel sits, and every fourth spreads them over both ends
+    for (int i = 0; i < numEdges; ++i)
+    {
+      int weight = std::rand() % 50;
+      if ( g % 4 == 3)
+	weight = (std::numeric_limits<int>::max)() - weight % 3;
+      else if ( g % 4 == 1 && weight % 2 == 1)
+	weight = (std::numeric_limits<int>::min)() + weight;
+      boost::add_edge( std::rand() % numVertices, std::rand() % numVertices, edge_weight( weight), graph);
+    }
+    
+    std::vector < edge_descriptor > spanning_tree;
+    boost::kruskal_minimum_spanning_tree( graph, std::back_inserter(spanning_tree));
+    EdgeWeightMap weightMap = boost::get(boost::edge_weight_t(), graph);
+    long long expectedWeight = 0;
+    for (size_t i = 0; i < spanning_tree.size(); ++i)
+      expectedWeight += boost::get(weightMap, spanning_tree[i]);
+    std::vector<int> expectedLabels( numVertices);
+    int numComponents = boost::connected_components( graph, &expectedLabels[0]);
+    batch.addGraph( graph);
+    batchWeight.push_back( expectedWeight);
+    batchSize.push_back( spanning_tree.size());
+    
+    Graph mst( numVertices);
+    for (size_t i = 0; i < spanning_tree.size(); ++i)
+      boost::add_edge( source( spanning_tree[i], graph), target( spanning_tree[i], graph),
+		       edge_weight( boost::get(weightMap, spanning_tree[i])), mst);
+    if ( !checkPathMaxima( mst))
+    {
+      std::cerr << "Graph " << g << " (" << numVertices << " vertices, " << numEdges << " edges): "
+		<< "PathMaxIndex disagrees with a walk along the forest." << std::endl;
+      return false;
+    }
+    
+    //kktMSF with either engine, then kktMST on the compressed graph, which
+    //gives no labels; the Kruskal labels stand in for them there
+    const char* names[] = { "kktForest", "filterKruskal", "compressed kktMST" };
+    MSTEngine engines[] = { kktEngine, filterKruskalEngine };
+    for (int e = 0; e < 3; ++e)
+    {
+      std::vector<int> components( expectedLabels);
+      Graph forest;
+      if ( e < 2)
+	forest = kktMSF( graph, components, engines[e]);
+      else
+      {
+	CompressedGraph compressed( graph);
+	forest = kktMST( compressed);
+      }
+      EdgeWeightMap forestWeights = boost::get(boost::edge_weight_t(), forest);
+      long long weight = 0;
+      edge_iterator edgeBegin, edgeEnd;
+      for ( boost::tie( edgeBegin, edgeEnd) = boost::edges( forest); edgeBegin != edgeEnd; ++edgeBegin)
+	weight += boost::get(forestWeights, *edgeBegin);
+      
+      //Same partition: labels agree along every edge and there are as many
+      bool sameComponents = *std::max_element( components.begin(), components.end()) == numComponents - 1;
+      for ( boost::tie( edgeBegin, edgeEnd) = boost::edges( graph); edgeBegin != edgeEnd; ++edgeBegin)
+	sameComponents = sameComponents && components[source(*edgeBegin, graph)] == components[target(*edgeBegin, graph)];
+      
+      if ( weight != expectedWeight || boost::num_edges(forest) != spanning_tree.size() || !sameComponents)
+      {
+	std::cerr << "Graph " << g << " (" << numVertices << " vertices, " << numEdges << " edges): "
+		  << names[e] << " gave weight " << weight
+		  << " in " << boost::num_edges(forest) << " edges, Kruskal " << expectedWeight << " in "
+		  << spanning_tree.size() << " edges; components " << (sameComponents ? "match" : "differ")
+		  << "." << std::endl;
+	return false;
+      }
+    }
+  }
+  
+  //The forests are read back after the batch is gone, from a copy of its edges
+  std::vector<WeightedEdge> edges = batch.getEdges();
+  std::vector<int> edgeOffset = batch.getEdgeOffset();
+  BatchMST batchMST( 2);
+  batchMST.run( batch);
+  batch.clear();
+  for (int g = 0; g < numGraphs; ++g)
+  {
+    long long weight = 0;
+    const int* forest = batchMST.forest(g);
+    for (int i = 0; i < batchMST.forestSize(g); ++i)
+      weight += edges[edgeOffset[g] + forest[i]].weight;
+    if ( batchMST.forestWeight(g) != batchWeight[g] || weight != batchWeight[g]
+	 || (size_t)batchMST.forestSize(g) != batchSize[g])
+    {
+      std::cerr << "Graph " << g << ": BatchMST gave weight " << batchMST.forestWeight(g) << " (" << weight
+		<< " from its edges) in " << batchMST.forestSize(g) << " edges, Kruskal " << batchWeight[g]
+		<< " in " << batchSize[g] << " edges." << std::endl;
+      return false;
+    }
+  }
+  std::cout << "All " << numGraphs << " forests match Kruskal." << std::endl;
+  return true;
+}
@@ -0,0 +1,123 @@
+//KKT hpp
+//Entry points of the KKT randomized minimum spanning forest algorithm.
+
+#ifndef KKT_TEST_H
+#define KKT_TEST_H
+
+#include <vector>
+
+#include "boruvka_tree/BoruvkaTree.hpp"
+#include "compressed_graph.hpp"
+#include "pipelined_loader.hpp"
+#include "weighted_edge.hpp"
+
+/**
+ * @var boost::adjacency_list - graph - Adjacency List representation of a graph
+ * @var int - numNodes - Number of nodes our graph contains
+ * @return void Updates the graph instead of returning anything
+ * Fills the graph with nodes and edges. Each vertex has a 1/1000 chance of beinga
+ * connected to another vertex, meaning each vertex will have 10 outgoing edges
+ * on average.
+ */
+void createGraph( Graph& graph);
+
+//Algorithm that computes the forest once the graph is in edge list form:
+//kktForest, or filterKruskal as a sort based reference
+enum MSTEngine { kktEngine, filterKruskalEngine };
+
+/**
+ * @var Graph& - graph - The input graph to run this algorithm on
+ * @var MSTEngine - engine - Algorithm to run
+ * @var int - numThreads - Threads for engines that use them (filterKruskal)
+ * @return Graph Returns a graph object with all the vertices and only the edges in the
+ * minimum spanning forest
+ * Runs the KKT MST algorithm on provied graph. Disconnected graphs and isolated
+ * vertices are fine; every component gets its own tree.
+ */
+Graph kktMST( Graph& graph, MSTEngine engine = kktEngine, int numThreads = 1);
+
+/**
+ * @var Graph& - graph - The input graph to run this algorithm on
+ * @var std::vector<int>& - components - Filled with a component label per vertex,
+ * numbered 0 .. (number of components - 1)
+ * @var MSTEngine - engine - Algorithm to run
+ * @var int - numThreads - Threads for engines that use them (filterKruskal)
+ * @return Graph Returns the minimum spanning forest, as kktMST does
+ * The labels come out of the union-find that links the forest edges, so they
+ * cost one find per vertex on top of the forest itself.
+ */
+Graph kktMSF( Graph& graph, std::vector<int>& components, MSTEngine engine = kktEngine, int numThreads = 1);
+
+/**
+ * @var CompressedGraph& - graph - The input graph in compressed form
+ * @return Graph Returns a graph object with all the vertices and only the edges in the
+ * minimum spanning forest
+ * Runs the Boruvka steps of the KKT MST algorithm directly on the compressed
+ * graph, then hands the (much smaller) contracted graph to kktForest.
+ */
+Graph kktMST( CompressedGraph& graph);
+
+/**
+ * @var PipelinedLoader& - loader - A loader that has read the whole input
+ * @return Graph Returns the minimum spanning forest of the loaded edges
+ * The loader's workers already found every vertex's lightest edge while the
+ * input was being read, so the first Boruvka step only has to contract. The
+ * edges are taken out of the loader as they are contracted, leaving it empty.
+ */
+Graph kktMST( PipelinedLoader& loader);
+
+/**
+ * @var int - numVertices - Vertices are numbered 0 .. numVertices - 1
+ * @var EdgeList& - edges - Edge list; consumed by the call
+ * @var std::vector<int>& - forest - The ids of the minimum spanning forest edges are appended here
+ * Recursive core of KKT: two Boruvka steps, a random half sample, F-heavy
+ * filtering against the sample's forest, and a recursive call on what is left.
+ */
+void kktForest( int numVertices, EdgeList& edges, std::vector<int>& forest);
+
+/**
+ * @var int - numVertices - Number of supervertices edges refers to
+ * @var EdgeList& - edges - Replaced by the contracted edge list
+ * @var std::vector<int>& - forest - The ids of the edges contracted away are appended here
+ * @return int Number of supervertices left that still have an edge
+ * Condenses the graph using the Boruvka algorithm. Supervertices left without
+ * edges are dropped, and only the lightest of any parallel edges is kept.
+ */
+int boruvkaStep( int numVertices, EdgeList& edges, std::vector<int>& forest);
+
+/**
+ * @var CompressedGraph& - graph - Compressed graph to condense
+ * @var std::vector<int>& - forest - The ids of the edges contracted away are appended here
+ * @return CompressedGraph Returns the condensed graph, keeping only the lightest
+ * edge between each pair of supervertices
+ * Condenses the graph using the Boruvka algorithm, decoding the neighbor lists
+ * block by block instead of expanding them. The contracted lists are gathered
+ * one supervertex at a time and encoded straight away.
+ */
+CompressedGraph boruvkaCut( CompressedGraph& graph, std::vector<int>& forest);
+
+/**
+ * @var int - numVertices - Number of vertices of the forest
+ * @var std::vector<WeightedEdge> - edges - Edges of a forest
+ * @var std::vector<int>& - parents - Parent of every Boruvka tree node, -1 for roots
+ * @var std::vector<int>& - weights - Weight of the edge each node picked when it joined its parent
+ * Builds the Boruvka tree of a forest. Its leaves are the forest's vertices
+ * and path maxima between leaves equal path maxima in the forest.
+ */
+void boruvkaHierarchy( int numVertices, std::vector<WeightedEdge> edges, std::vector<int>& parents,
+		       std::vector<int>& weights);
+
+/**
+ * @var const std::vector<int>& - parents - Boruvka tree from boruvkaHierarchy
+ * @var const std::vector<int>& - weights - Its weights, as from boruvkaHierarchy
+ * @var const EdgeList& - edges - Edges between the tree's leaves
+ * @var std::vector<int>& - heaviest - Filled with the heaviest weight on the forest path
+ * between the ends of every edge, or INT_MIN where the ends are equal or lie in different trees
+ * Splits every path at the lowest common ancestor of its ends, found offline
+ * with Tarjan's algorithm, and answers both halves with MSTVerifier. Time is
+ * linear in the tree and edges, up to the union-find's inverse Ackermann factor.
+ */
+void forestPathMaxima( const std::vector<int>& parents, const std::vector<int>& weights,
+		       const EdgeList& edges, std::vector<int>& heaviest);
+
+#endif
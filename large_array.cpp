@@ -0,0 +1,136 @@
+/*
+ * Storage for LargeArray. Big blocks are mapped directly so their pages can
+ * be advised or bound before anything touches them. NUMA placement goes
+ * through the mbind system call, so no libnuma is needed; on a single node
+ * machine it is skipped.
+ */
+
+#include "large_array.hpp"
+
+#include <dirent.h>
+#include <new>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+  //Memory policy modes from <numaif.h>
+  const int bindPolicy = 2;
+  const int interleavePolicy = 3;
+
+  MemoryPolicy currentPolicy = { smallPages, firstTouch, 1 };
+
+  size_t mappedBytes( size_t bytes)
+  {
+    return (bytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+  }
+
+  void bindPages( void* data, size_t bytes, int policy, const std::vector<int>& nodes)
+  {
+    unsigned long mask[16];
+    std::memset( mask, 0, sizeof(mask));
+    for (size_t i = 0; i < nodes.size(); ++i)
+      mask[nodes[i] / (8*sizeof(unsigned long))] |= 1UL << (nodes[i] % (8*sizeof(unsigned long)));
+    //Placement is only a hint for speed, so a failed mbind is ignored
+    syscall( SYS_mbind, data, bytes, policy, mask, 8*sizeof(mask), 0);
+  }
+
+  //Maps a huge page aligned block. Transparent huge pages are asked for when
+  //huge is set; otherwise the kernel's default applies, as for any malloc.
+  void* mapAligned( size_t bytes, bool huge)
+  {
+    size_t length = bytes + hugePageSize;
+    char* raw = static_cast<char*>( mmap( NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if ( raw == MAP_FAILED)
+      return NULL;
+    char* aligned = raw + (hugePageSize - (size_t)raw % hugePageSize) % hugePageSize;
+    if ( aligned > raw)
+      munmap( raw, aligned - raw);
+    if ( raw + length > aligned + bytes)
+      munmap( aligned + bytes, raw + length - (aligned + bytes));
+    if ( huge)
+      madvise( aligned, bytes, MADV_HUGEPAGE);
+    return aligned;
+  }
+}
+
+MemoryPolicy getMemoryPolicy()
+{
+  return currentPolicy;
+}
+
+void setMemoryPolicy( const MemoryPolicy& policy)
+{
+  currentPolicy = policy;
+  if ( currentPolicy.numThreads < 1)
+    currentPolicy.numThreads = 1;
+}
+
+int numaNodes()
+{
+  static int count = 0;
+  if ( count > 0)
+    return count;
+  DIR* directory = opendir( "/sys/devices/system/node");
+  if ( directory != NULL)
+  {
+    struct dirent* entry;
+    while ( (entry = readdir( directory)) != NULL)
+      if ( std::strncmp( entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9')
+	++count;
+    closedir( directory);
+  }
+  if ( count == 0)
+    count = 1;
+  return count;
+}
+
+void* allocateLarge( size_t bytes, const MemoryPolicy& policy)
+{
+  if ( bytes < hugePageSize)
+    return ::operator new( bytes);
+
+  size_t length = mappedBytes( bytes);
+  void* data = NULL;
+  if ( policy.pages == explicitHugePages)
+  {
+    data = mmap( NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if ( data == MAP_FAILED)
+      data = NULL;
+  }
+  if ( data == NULL)
+    data = mapAligned( length, policy.pages != smallPages);
+  if ( data == NULL)
+    throw std::bad_alloc();
+
+  int nodes = numaNodes();
+  if ( nodes > 1 && policy.placement == interleaveNodes)
+  {
+    std::vector<int> all;
+    for (int n = 0; n < nodes; ++n)
+      all.push_back(n);
+    bindPages( data, length, interleavePolicy, all);
+  }
+  else if ( nodes > 1 && policy.placement == partitionNodes)
+  {
+    int slices = policy.numThreads > 1 ? policy.numThreads : 1;
+    for (int t = 0; t < slices; ++t)
+    {
+      //Slice borders are rounded to huge pages, so they match the fill threads' only roughly
+      size_t begin = mappedBytes( bytes*t/slices), end = mappedBytes( bytes*(t + 1)/slices);
+      if ( end > begin)
+	bindPages( static_cast<char*>(data) + begin, end - begin, bindPolicy, std::vector<int>( 1, t % nodes));
+    }
+  }
+  return data;
+}
+
+void releaseLarge( void* data, size_t bytes)
+{
+  if ( bytes < hugePageSize)
+    ::operator delete( data);
+  else
+    munmap( data, mappedBytes( bytes));
+}
@@ -0,0 +1,148 @@
+//Large array hpp
+//Huge page and NUMA aware storage for the big per-vertex and per-edge arrays.
+
+#ifndef LARGE_ARRAY_H
+#define LARGE_ARRAY_H
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+enum PageMode { smallPages, transparentHugePages, explicitHugePages };
+enum NumaPlacement { firstTouch, interleaveNodes, partitionNodes };
+
+//How LargeArray storage is obtained. The default, small pages placed by a
+//single first-touching thread, behaves like a plain std::vector.
+struct MemoryPolicy
+{
+  PageMode pages;
+  NumaPlacement placement;
+  int numThreads; //threads that initialize, and so first touch, a new array
+};
+
+const size_t hugePageSize = 2 << 20;
+
+MemoryPolicy getMemoryPolicy();
+//Applies to arrays allocated from now on; numThreads is raised to at least 1
+void setMemoryPolicy( const MemoryPolicy& policy);
+
+//Number of NUMA nodes the kernel reports, at least 1
+int numaNodes();
+
+/**
+ * @var size_t - bytes - Size of the allocation
+ * @var const MemoryPolicy& - policy - Pages and placement to use
+ * @return void* The storage; throws std::bad_alloc on failure
+ * Anything under one huge page comes from operator new. Larger blocks are
+ * mapped in whole huge pages; explicit huge pages fall back to transparent
+ * ones when none are reserved. Interleaved placement spreads the pages over
+ * all nodes, partitioned placement binds slice t of numThreads to node
+ * t % numaNodes(), matching the slice thread t initializes.
+ */
+void* allocateLarge( size_t bytes, const MemoryPolicy& policy);
+
+//Frees storage from allocateLarge; bytes must be the size it was asked for
+void releaseLarge( void* data, size_t bytes);
+
+//Fixed size array of a plain type in allocateLarge storage. Elements are
+//initialized by policy.numThreads threads, each writing its own slice.
+template <class T>
+class LargeArray
+{
+  public:
+    LargeArray();
+    LargeArray( size_t size, const T& value = T());
+    ~LargeArray();
+
+    //Replaces the contents with size copies of value, under the current policy
+    void assign( size_t size, const T& value = T());
+
+    size_t size() const { return count; }
+    T* data() { return elements; }
+    const T* data() const { return elements; }
+    T& operator[]( size_t i) { return elements[i]; }
+    const T& operator[]( size_t i) const { return elements[i]; }
+
+  private:
+    T* elements;
+    size_t count;
+
+    LargeArray( const LargeArray&);
+    LargeArray& operator=( const LargeArray&);
+
+    static void fill( T* first, T* last, T value);
+};
+
+template <class T>
+LargeArray<T>::LargeArray()
+{
+  this->elements = NULL;
+  this->count = 0;
+}
+
+template <class T>
+LargeArray<T>::LargeArray( size_t size, const T& value)
+{
+  this->elements = NULL;
+  this->count = 0;
+  assign( size, value);
+}
+
+template <class T>
+LargeArray<T>::~LargeArray()
+{
+  if ( elements != NULL)
+    releaseLarge( elements, count*sizeof(T));
+}
+
+template <class T>
+void LargeArray<T>::assign( size_t size, const T& value)
+{
+  if ( elements != NULL)
+    releaseLarge( elements, count*sizeof(T));
+  elements = NULL;
+  count = size;
+  if ( size == 0)
+    return;
+
+  MemoryPolicy policy = getMemoryPolicy();
+  elements = static_cast<T*>( allocateLarge( size*sizeof(T), policy));
+  int numThreads = size*sizeof(T) < hugePageSize ? 1 : policy.numThreads;
+  std::vector<std::thread> threads;
+  for (int t = 1; t < numThreads; ++t)
+    threads.push_back( std::thread( fill, elements + size*t/numThreads, elements + size*(t + 1)/numThreads, value));
+  fill( elements, elements + size/numThreads, value);
+  for (size_t t = 0; t < threads.size(); ++t)
+    threads[t].join();
+}
+
+template <class T>
+void LargeArray<T>::fill( T* first, T* last, T value)
+{
+  for ( ; first != last; ++first)
+    *first = value;
+}
+
+//Allocator giving std::vector allocateLarge storage, under the policy current
+//when the vector allocates, for edge lists that grow or shrink. Unlike a
+//LargeArray, the vector initializes its own elements on the calling thread.
+template <class T>
+class LargeAllocator
+{
+  public:
+    typedef T value_type;
+
+    LargeAllocator() {}
+    template <class U> LargeAllocator( const LargeAllocator<U>&) {}
+
+    T* allocate( size_t n) { return static_cast<T*>( allocateLarge( n*sizeof(T), getMemoryPolicy())); }
+    void deallocate( T* data, size_t n) { releaseLarge( data, n*sizeof(T)); }
+};
+
+template <class T, class U>
+bool operator==( const LargeAllocator<T>&, const LargeAllocator<U>&) { return true; }
+
+template <class T, class U>
+bool operator!=( const LargeAllocator<T>&, const LargeAllocator<U>&) { return false; }
+
+#endif
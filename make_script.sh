@@ -1 +1 @@
-g++ -Wall -g --std=c++0x *.cpp boruvka_tree/*.cpp
+g++ -Wall -g --std=c++0x -pthread *.cpp boruvka_tree/*.cpp
@@ -0,0 +1,194 @@
+/*
+ * Online path maxima on a minimum spanning forest. Kruskal's merge order is
+ * the single-linkage dendrogram, and the last merge to join u and v, the
+ * heaviest edge on their forest path, is their lowest common ancestor there.
+ * LCA is a range minimum over the depths of an Euler tour of the dendrogram.
+ * Neighboring tour depths differ by exactly one, which is what lets the
+ * blocked table below stay linear in size (Bender and Farach-Colton): a
+ * block of b steps has one of 2^(b-1) shapes, each answered by a small table,
+ * and only the n / b block minima need a sparse table.
+ */
+
+#include "path_max_index.hpp"
+
+#include <algorithm>
+#include <thread>
+
+const int PathMaxIndex::noPath = -1;
+
+PathMaxIndex::PathMaxIndex( const SingleLinkage& dendrogram)
+{
+  const std::vector<int>& left = dendrogram.getLeft();
+  const std::vector<int>& right = dendrogram.getRight();
+  n = dendrogram.numVertices();
+  mergeEdges = dendrogram.getMergeEdges();
+  superRoot = n + left.size();
+  int numNodes = superRoot + 1;
+
+  //The roots are the nodes no merge names as a child
+  std::vector<bool> isChild( numNodes, false);
+  for (size_t i = 0; i < left.size(); ++i)
+  {
+    isChild[left[i]] = true;
+    isChild[right[i]] = true;
+  }
+
+  //Iterative DFS so deep dendrograms can't overflow the stack. The tour
+  //returns to superRoot after every tree, at depth 0.
+  depth.assign( numNodes, 0);
+  first.assign( numNodes, 0);
+  euler.clear();
+  euler.reserve( 2*(size_t)numNodes - 1);
+  euler.push_back( superRoot);
+  std::vector<int> stack, visited;   //visited: children of the node entered so far
+  for (int r = 0; r < superRoot; ++r)
+  {
+    if ( isChild[r]) continue;
+
+    depth[r] = 1;
+    first[r] = euler.size();
+    euler.push_back(r);
+    stack.push_back(r);
+    visited.push_back(0);
+    while ( !stack.empty())
+    {
+      int x = stack.back();
+      if ( x < n || visited.back() == 2)
+      {
+	stack.pop_back();
+	visited.pop_back();
+	euler.push_back( stack.empty() ? superRoot : stack.back());
+	continue;
+      }
+      int c = visited.back() == 0 ? left[x - n] : right[x - n];
+      ++visited.back();
+      depth[c] = depth[x] + 1;
+      first[c] = euler.size();
+      euler.push_back(c);
+      stack.push_back(c);
+      visited.push_back(0);
+    }
+  }
+
+  //Blocks of half the tour's log; at most 15 steps keeps offsets in a byte
+  //and the shape tables small
+  int e = euler.size(), logE = 0;
+  while ( ((size_t)2 << logE) <= (size_t)e) ++logE;
+  blockSize = std::max( 1, std::min( 15, logE / 2));
+  int numBlocks = (e + blockSize - 1) / blockSize;
+
+  //Bit k of a shape is set when step k goes down the tree. Steps past the
+  //end of the tour count as going down, and are never asked about.
+  blockShape.assign( numBlocks, 0);
+  for (int b = 0; b < numBlocks; ++b)
+    for (int k = 0; k + 1 < blockSize; ++k)
+    {
+      int pos = b*blockSize + k;
+      if ( pos + 1 >= e || depth[euler[pos + 1]] > depth[euler[pos]])
+	blockShape[b] |= 1 << k;
+    }
+
+  int numShapes = 1 << (blockSize - 1);
+  inBlock.assign( (size_t)numShapes*blockSize*blockSize, 0);
+  for (int shape = 0; shape < numShapes; ++shape)
+    for (int i = 0; i < blockSize; ++i)
+    {
+      unsigned char* row = &inBlock[((size_t)shape*blockSize + i)*blockSize];
+      int height = 0, lowest = 0, lowestAt = i;
+      row[i] = i;
+      for (int j = i + 1; j < blockSize; ++j)
+      {
+	height += (shape >> (j - 1)) & 1 ? 1 : -1;
+	if ( height < lowest)
+	{
+	  lowest = height;
+	  lowestAt = j;
+	}
+	row[j] = lowestAt;
+      }
+    }
+
+  logTable.assign( numBlocks + 1, 0);
+  for (int i = 2; i <= numBlocks; ++i)
+    logTable[i] = logTable[i/2] + 1;
+  int levels = logTable[numBlocks] + 1;
+  blockSparse.assign( (size_t)levels*numBlocks, 0);
+  for (int b = 0; b < numBlocks; ++b)
+    blockSparse[b] = minInBlock( b, 0, std::min( blockSize, e - b*blockSize) - 1);
+  for (int k = 1; k < levels; ++k)
+  {
+    int* row = &blockSparse[(size_t)k*numBlocks];
+    const int* below = &blockSparse[(size_t)(k - 1)*numBlocks];
+    for (int b = 0; b + (1 << k) <= numBlocks; ++b)
+      row[b] = shallower( below[b], below[b + (1 << (k - 1))]);
+  }
+}
+
+//Tour position of the shallowest entry among positions i .. j of a block
+int PathMaxIndex::minInBlock( int block, int i, int j) const
+{
+  return block*blockSize + inBlock[((size_t)blockShape[block]*blockSize + i)*blockSize + j];
+}
+
+//The tour position of the two with the shallower node
+int PathMaxIndex::shallower( int a, int b) const
+{
+  return depth[euler[a]] <= depth[euler[b]] ? a : b;
+}
+
+int PathMaxIndex::lca( int u, int v) const
+{
+  int a = first[u], b = first[v];
+  if ( a > b) std::swap(a, b);
+  int blockA = a / blockSize, blockB = b / blockSize;
+  int lowest;
+  if ( blockA == blockB)
+    lowest = minInBlock( blockA, a % blockSize, b % blockSize);
+  else
+  {
+    lowest = shallower( minInBlock( blockA, a % blockSize, blockSize - 1), minInBlock( blockB, 0, b % blockSize));
+    if ( blockB - blockA > 1)
+    {
+      int numBlocks = blockShape.size();
+      int k = logTable[blockB - blockA - 1];
+      lowest = shallower( lowest, shallower( blockSparse[(size_t)k*numBlocks + blockA + 1],
+					     blockSparse[(size_t)k*numBlocks + blockB - (1 << k)]));
+    }
+  }
+  return euler[lowest] == superRoot ? -1 : euler[lowest];
+}
+
+int PathMaxIndex::query( int u, int v) const
+{
+  if ( u == v) return noPath;
+  int l = lca(u, v);
+  return l < 0 ? noPath : mergeEdges[l - n];
+}
+
+void PathMaxIndex::query( const std::vector<int>& u, const std::vector<int>& v, std::vector<int>& answer, int numThreads) const
+{
+  answer.resize( u.size());
+  if ( numThreads < 1) numThreads = 1;
+
+  //The index is read only after construction, so threads share it freely
+  std::vector<std::thread> threads;
+  size_t chunk = (u.size() + numThreads - 1) / numThreads;
+  for (int t = 1; t < numThreads && t*chunk < u.size(); ++t)
+    threads.push_back( std::thread( &PathMaxIndex::queryRange, this, &u, &v, &answer,
+				    t*chunk, std::min( u.size(), (t + 1)*chunk)));
+  queryRange( &u, &v, &answer, 0, std::min( u.size(), chunk));
+  for (size_t t = 0; t < threads.size(); ++t)
+    threads[t].join();
+}
+
+void PathMaxIndex::queryRange( const std::vector<int>* u, const std::vector<int>* v, std::vector<int>* answer,
+			       size_t begin, size_t end) const
+{
+  for (size_t i = begin; i < end; ++i)
+    (*answer)[i] = query( (*u)[i], (*v)[i]);
+}
+
+int PathMaxIndex::size() const
+{
+  return n;
+}
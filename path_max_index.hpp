@@ -0,0 +1,55 @@
+//Path maximum index hpp
+//Answers "heaviest edge between u and v" queries on a minimum spanning forest online.
+
+#ifndef PATH_MAX_INDEX_H
+#define PATH_MAX_INDEX_H
+
+#include <cstddef>
+#include <vector>
+
+#include "clustering.hpp"
+
+//The heaviest edge on the forest path between u and v is the merge at the
+//lowest common ancestor of u and v in the single-linkage dendrogram, so the
+//index is an LCA structure over the dendrogram of a SingleLinkage built from
+//the forest. Preprocessing and space are linear, queries take constant time.
+class PathMaxIndex{
+
+  public:
+    //Returned when u == v or u and v lie in different trees
+    static const int noPath;
+
+    PathMaxIndex( const SingleLinkage& dendrogram);
+
+    //Input position of the heaviest forest edge between u and v, numbered as
+    //by SingleLinkage::getMergeEdges, or noPath
+    int query( int u, int v) const;
+    //Answers query(u[i], v[i]) into answer[i], splitting the batch over numThreads threads
+    void query( const std::vector<int>& u, const std::vector<int>& v, std::vector<int>& answer, int numThreads = 1) const;
+
+    //Dendrogram node (numVertices + merge number, or a leaf) joining u and v, -1 across trees
+    int lca( int u, int v) const;
+    int size() const;
+
+  private:
+    int n;                    //leaves, the forest's vertices
+    int superRoot;            //extra node above every tree, so the tour is one walk
+    std::vector<int> mergeEdges;
+    std::vector<int> depth, first, euler;
+
+    //Euler tour positions in blocks of blockSize. Depths of neighboring tour
+    //entries differ by one, so a block's shape is the bit pattern of its
+    //steps, and one table per shape answers every query inside a block;
+    //a sparse table over the block minima answers the whole blocks between.
+    int blockSize;
+    std::vector<int> blockShape;
+    std::vector<unsigned char> inBlock;   //[shape][i][j]: offset of the minimum of i .. j
+    std::vector<int> blockSparse;         //level k: position of the minimum of 2^k blocks
+    std::vector<int> logTable;
+
+    int minInBlock( int block, int i, int j) const;
+    int shallower( int a, int b) const;
+    void queryRange( const std::vector<int>* u, const std::vector<int>* v, std::vector<int>* answer,
+		     size_t begin, size_t end) const;
+};
+#endif
@@ -0,0 +1,319 @@
+/*
+ * Pipelined edge list loading. Parsing and the first Boruvka pass's running
+ * minimum per vertex overlap: the reader publishes every parsed chunk and
+ * the first idle worker folds it into its candidates while the next chunk
+ * is read.
+ */
+
+#include "pipelined_loader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+  //Recognized by its source of -1; a real edge may weigh INT_MAX
+  const WeightedEdge noEdge = { -1, -1, (std::numeric_limits<int>::max)(), (std::numeric_limits<int>::max)() };
+
+  //Reads an optionally signed integer at text[pos], skipping blanks first
+  bool parseInt( const char* text, size_t end, size_t& pos, long long& value)
+  {
+    while ( pos < end && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r'))
+      ++pos;
+    bool negative = pos < end && text[pos] == '-';
+    if ( negative || (pos < end && text[pos] == '+'))
+      ++pos;
+    if ( pos == end || text[pos] < '0' || text[pos] > '9')
+      return false;
+    value = 0;
+    for ( ; pos < end && text[pos] >= '0' && text[pos] <= '9'; ++pos)
+      value = value*10 + (text[pos] - '0');
+    if ( negative)
+      value = -value;
+    return true;
+  }
+}
+
+PipelinedLoader::PipelinedLoader( int numWorkers, size_t chunkBytes)
+{
+  this->numWorkers = numWorkers > 0 ? numWorkers : 1;
+  this->chunkBytes = chunkBytes > 0 ? chunkBytes : 1;
+  this->vertexCount = 0;
+  this->edgeCount = 0;
+  this->numPublished = 0;
+  this->numClaimed = 0;
+  this->finished = false;
+}
+
+bool PipelinedLoader::load( const std::string& path)
+{
+  return load( path, 0, -1);
+}
+
+bool PipelinedLoader::load( const std::string& path, long long from, long long to)
+{
+  int fd = ::open( path.c_str(), O_RDONLY);
+  if ( fd < 0)
+    return false;
+  struct stat status;
+  if ( fstat( fd, &status) != 0 || !S_ISREG( status.st_mode))
+  {
+    //Pipes and the like go through stdio, and only whole
+    ::close( fd);
+    if ( from > 0 || to >= 0)
+      return false;
+    std::FILE* file = std::fopen( path.c_str(), "r");
+    bool loaded = load( file);
+    if ( file != NULL)
+      std::fclose( file);
+    return loaded;
+  }
+
+  size_t size = status.st_size;
+  if ( from < 0) from = 0;
+  if ( to < 0 || (size_t)to > size) to = size;
+  //The mapping starts a byte early, so the range can see whether it starts a line
+  size_t offset = from > 0 ? from - 1 : 0;
+  offset -= offset % sysconf( _SC_PAGESIZE);
+  void* mapped = MAP_FAILED;
+  if ( from < to)
+  {
+    mapped = mmap( NULL, size - offset, PROT_READ, MAP_PRIVATE, fd, offset);
+    if ( mapped == MAP_FAILED)
+    {
+      ::close( fd);
+      return false;
+    }
+    madvise( mapped, size - offset, MADV_SEQUENTIAL);
+  }
+  ::close( fd);
+
+  begin();
+  if ( mapped != MAP_FAILED)
+  {
+    //A line belongs to the range holding its first byte
+    const char* text = static_cast<const char*>( mapped);
+    size_t length = size - offset, pos = from - offset, stop = to - offset;
+    while ( pos > 0 && pos < length && text[pos - 1] != '\n')
+      ++pos;
+    while ( stop < length && text[stop - 1] != '\n')
+      ++stop;
+    while ( pos < stop)
+    {
+      //A window always ends on a line break, unless it is the end of the range
+      size_t window = std::min( chunkBytes, stop - pos);
+      std::vector<WeightedEdge> chunk;
+      size_t used = parse( text + pos, window, pos + window == stop, chunk);
+      while ( used == 0 && pos + window < stop)
+      {
+	window = std::min( 2*window, stop - pos);
+	used = parse( text + pos, window, pos + window == stop, chunk);
+      }
+      publish( chunk);
+      pos += used;
+    }
+    munmap( mapped, length);
+  }
+  finish();
+  return true;
+}
+
+bool PipelinedLoader::load( std::FILE* file)
+{
+  if ( file == NULL)
+    return false;
+
+  begin();
+  std::vector<char> buffer( chunkBytes);
+  size_t held = 0;
+  bool last = false;
+  while ( !last)
+  {
+    if ( held == buffer.size()) //a line longer than a chunk
+      buffer.resize( 2*buffer.size());
+    size_t got = std::fread( &buffer[held], 1, buffer.size() - held, file);
+    last = got == 0;
+    held += got;
+
+    std::vector<WeightedEdge> chunk;
+    size_t used = parse( buffer.data(), held, last, chunk);
+    publish( chunk);
+    std::memmove( buffer.data(), buffer.data() + used, held - used);
+    held -= used;
+  }
+  finish();
+  return !std::ferror( file);
+}
+
+int PipelinedLoader::numVertices() const
+{
+  return this->vertexCount;
+}
+
+int PipelinedLoader::numEdges() const
+{
+  return this->edgeCount;
+}
+
+const WeightedEdge& PipelinedLoader::getEdge( int id) const
+{
+  size_t chunk = std::upper_bound( chunkStart.begin(), chunkStart.end(), id) - chunkStart.begin() - 1;
+  return chunks[chunk][id - chunkStart[chunk]];
+}
+
+void PipelinedLoader::copyEdges( EdgeList& edges) const
+{
+  edges.reserve( edges.size() + edgeCount);
+  for (size_t c = 0; c < chunks.size(); ++c)
+    edges.insert( edges.end(), chunks[c].begin(), chunks[c].end());
+}
+
+bool PipelinedLoader::takeChunk( std::vector<WeightedEdge>& chunk)
+{
+  chunk.clear();
+  if ( chunks.empty())
+    return false;
+  chunk.swap( chunks.front());
+  chunks.pop_front();
+  chunkStart.erase( chunkStart.begin());
+  return true;
+}
+
+const LargeArray<WeightedEdge>& PipelinedLoader::getCandidates() const
+{
+  return this->candidates;
+}
+
+void PipelinedLoader::begin()
+{
+  vertexCount = 0;
+  edgeCount = 0;
+  chunks.clear();
+  chunkStart.clear();
+  ownCandidates.assign( numWorkers, std::vector<WeightedEdge>());
+  numPublished = 0;
+  numClaimed = 0;
+  finished = false;
+  for (int w = 0; w < numWorkers; ++w)
+    threads.push_back( std::thread( &PipelinedLoader::worker, this, w));
+}
+
+void PipelinedLoader::publish( std::vector<WeightedEdge>& chunk)
+{
+  if ( chunk.empty())
+    return;
+  {
+    std::lock_guard<std::mutex> hold( lock);
+    chunkStart.push_back( chunk[0].id);
+    chunks.push_back( std::vector<WeightedEdge>());
+    chunks.back().swap( chunk);
+    ++numPublished;
+  }
+  published.notify_all();
+}
+
+/**
+ * Lets the workers drain the last chunks, then merges their candidates into
+ * one array indexed by vertex, every worker thread taking a range of vertices.
+ */
+void PipelinedLoader::finish()
+{
+  {
+    std::lock_guard<std::mutex> hold( lock);
+    finished = true;
+  }
+  published.notify_all();
+  for (size_t t = 0; t < threads.size(); ++t)
+    threads[t].join();
+  threads.clear();
+
+  candidates.assign( vertexCount, noEdge);
+  for (int w = 1; w < numWorkers; ++w)
+    threads.push_back( std::thread( &PipelinedLoader::mergeCandidates, this,
+				    (int)((long long)vertexCount*w/numWorkers),
+				    (int)((long long)vertexCount*(w + 1)/numWorkers)));
+  mergeCandidates( 0, vertexCount/numWorkers);
+  for (size_t t = 0; t < threads.size(); ++t)
+    threads[t].join();
+  threads.clear();
+  ownCandidates.assign( numWorkers, std::vector<WeightedEdge>());
+}
+
+void PipelinedLoader::mergeCandidates( int first, int last)
+{
+  for (int w = 0; w < numWorkers; ++w)
+  {
+    const std::vector<WeightedEdge>& own = ownCandidates[w];
+    int end = std::min( last, (int)own.size());
+    for (int v = first; v < end; ++v)
+      candidates[v] = findMinWeightEdge( candidates[v], own[v]);
+  }
+}
+
+/**
+ * Parses the complete lines of text[0, length) into chunk, or every line if
+ * last is set. Edges are numbered in input order. Returns the bytes used.
+ */
+size_t PipelinedLoader::parse( const char* text, size_t length, bool last, std::vector<WeightedEdge>& chunk)
+{
+  size_t end = length;
+  if ( !last)
+  {
+    while ( end > 0 && text[end - 1] != '\n')
+      --end;
+  }
+
+  size_t pos = 0;
+  while ( pos < end)
+  {
+    long long source, target, weight;
+    if ( text[pos] != '#' && parseInt( text, end, pos, source) && parseInt( text, end, pos, target)
+	 && parseInt( text, end, pos, weight) && source >= 0 && target >= 0
+	 && source < (std::numeric_limits<int>::max)() && target < (std::numeric_limits<int>::max)())
+    {
+      WeightedEdge edge = { (int)source, (int)target, (int)weight, edgeCount++ };
+      chunk.push_back( edge);
+      vertexCount = std::max( vertexCount, (int)std::max( source, target) + 1);
+    }
+    //Anything else on the line, comments and malformed lines included, is skipped
+    while ( pos < end && text[pos] != '\n')
+      ++pos;
+    ++pos;
+  }
+  return end;
+}
+
+void PipelinedLoader::worker( int w)
+{
+  std::vector<WeightedEdge>& own = ownCandidates[w];
+  while ( true)
+  {
+    const std::vector<WeightedEdge>* chunk;
+    {
+      std::unique_lock<std::mutex> hold( lock);
+      while ( numClaimed == numPublished && !finished)
+	published.wait( hold);
+      if ( numClaimed == numPublished)
+	return;
+      chunk = &chunks[numClaimed++];
+    }
+
+    for (size_t i = 0; i < chunk->size(); ++i)
+    {
+      const WeightedEdge& edge = (*chunk)[i];
+      if ( edge.source == edge.target)
+	continue;
+      size_t last = std::max( edge.source, edge.target);
+      if ( last >= own.size())
+	own.resize( std::max( last + 1, 2*own.size()), noEdge);
+      own[edge.source] = findMinWeightEdge( own[edge.source], edge);
+      own[edge.target] = findMinWeightEdge( own[edge.target], edge);
+    }
+  }
+}
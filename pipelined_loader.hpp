@@ -0,0 +1,76 @@
+//Pipelined loader hpp
+//Reads an edge list while worker threads already run the first Boruvka pass over it.
+
+#ifndef PIPELINED_LOADER_H
+#define PIPELINED_LOADER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "large_array.hpp"
+#include "weighted_edge.hpp"
+
+//Loads "source target weight" lines, one edge per line; lines starting with
+//# are skipped. The calling thread parses the input chunk by chunk and hands
+//each chunk to the workers. Every chunk goes to one worker, which folds it
+//into its own lightest edge per vertex, so each edge is read once; when the
+//input ends the workers' candidates are merged, in parallel, and are the
+//first Boruvka step's picks for kktMST(PipelinedLoader&). The price is a
+//candidate array per worker while loading.
+class PipelinedLoader
+{
+  public:
+    PipelinedLoader( int numWorkers = 1, size_t chunkBytes = 4 << 20);
+
+    //All return false if the input can't be read; a file is read through mmap when possible
+    bool load( const std::string& path);
+    bool load( std::FILE* file);
+    //Loads the lines whose first byte lies in [from, to) of a regular file; to < 0 means
+    //the end of the file. Ranges that split a file hand every line to exactly one of them.
+    bool load( const std::string& path, long long from, long long to);
+
+    int numVertices() const;
+    int numEdges() const;
+    //Edge id as numbered in input order
+    const WeightedEdge& getEdge( int id) const;
+    //Appends every edge, in input order, to edges
+    void copyEdges( EdgeList& edges) const;
+    //Moves the next chunk of edges, in input order, into chunk and releases it.
+    //Returns false once every chunk has been taken; getEdge and copyEdges only
+    //see the edges not taken yet.
+    bool takeChunk( std::vector<WeightedEdge>& chunk);
+    //Lightest edge at every vertex, self loops left out; weight is INT_MAX where there is none
+    const LargeArray<WeightedEdge>& getCandidates() const;
+
+  private:
+    int numWorkers;
+    size_t chunkBytes;
+    int vertexCount;
+    int edgeCount;
+    std::deque< std::vector<WeightedEdge> > chunks;
+    std::vector<int> chunkStart;
+    std::vector< std::vector<WeightedEdge> > ownCandidates; //lightest edges in worker w's chunks
+    LargeArray<WeightedEdge> candidates;
+
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable published;
+    size_t numPublished;
+    size_t numClaimed;
+    bool finished;
+
+    void begin();
+    void publish( std::vector<WeightedEdge>& chunk);
+    void finish();
+    size_t parse( const char* text, size_t length, bool last, std::vector<WeightedEdge>& chunk);
+    void worker( int w);
+    void mergeCandidates( int first, int last);
+};
+
+#endif
@@ -1,40 +1,104 @@
 /* Code directly adapted from T. Hagerup's MST Verification code written in D */
 #include "verification.hpp"
 
-MSTVerifier::MSTVerifier( BoruvkaTree treeIn, std::vector<int> weight,std::vector<int> upper,std::vector<int> lower)
+#include <atomic>
+#include <mutex>
+
+namespace
 {
-  tree = BoruvkaTree(treeIn);
+  //Heights up to this use the table generated at compile time
+  const int smallHeight = 7;
+
+  constexpr int highestBit( int S) { return S <= 1 ? 0 : 1 + highestBit( S >> 1); }
+  constexpr int countBits( int S) { return S == 0 ? 0 : (S & 1) + countBits( S >> 1); }
+  //The element of S with k elements above it
+  constexpr int fromTop( int S, int k) { return k == 0 ? highestBit(S) : fromTop( S & ~(1 << highestBit(S)), k - 1); }
+  //A set of 2k+1 or 2k+2 elements has k above its median, as in median_table
+  constexpr int medianOf( int S) { return S == 0 ? -1 : fromTop( S, (countBits(S) - 1) / 2); }
+
+  template <int... I> struct Indices {};
+  template <int N, int... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+  template <int... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+
+  template <class Sequence> struct SmallMedians;
+  template <int... I> struct SmallMedians< Indices<I...> >
+  {
+    static const int table[sizeof...(I)];
+  };
+  template <int... I> const int SmallMedians< Indices<I...> >::table[sizeof...(I)] = { medianOf(I)... };
+
+  typedef SmallMedians< MakeIndices< (1 << (smallHeight + 1))>::type> SmallMedianTable;
+
+  static_assert( medianOf( 0x16) == 2 && medianOf( 0x0f) == 2, "median of a bit set");
+
+  struct CachedTable
+  {
+    int height;
+    std::vector<int> median;
+  };
+
+  //Entries only depend on the set, so the tallest table built so far serves
+  //every lower height. Tables it replaced are never freed, since verifiers
+  //on other threads may still be reading them.
+  std::atomic<CachedTable*> largestTable( NULL);
+  std::mutex tableLock;
+}
+
+MSTVerifier::MSTVerifier( int root, Span<int> child, Span<int> sibling, Span<int> weight, Span<int> upper, Span<int> lower)
+{
+  this->root = root;
   this->height = 0;
+  this->n = child.size();
+  this->m = upper.size();
+  this->child = child;
+  this->sibling = sibling;
+  this->weight = weight;
   this->upper = upper;
   this->lower = lower;
-  this->weight = weight;
-  
-  this->child = tree.getChildren();
-  this->sibling = tree.getSiblings();
+  this->median = NULL;
 }
 
 std::vector<int> MSTVerifier::treePathMaxima()
 {
-  L = std::vector<int>(tree.getChildren().size(), -1);
-  Lnext = std::vector<int>(upper.size(), -1);
-  
+  depth.assign( n, 0);
+  D.assign( n, 0);
+  L.assign( n, -1);
+  Lnext.assign( m, -1);
+  answer.assign( m, -1);
+  height = 0;
+
   for (int i=0;i<m;i++) { // distribute queries to lower nodes
     Lnext[i]=L[lower[i]];
     L[lower[i]]=i;
   }
-  
-  return tree_path_maxima( tree.getRootInt(), child, sibling, weight, upper, lower);
-  
-}
 
-std::vector<int> MSTVerifier::tree_path_maxima(int root,std::vector<int> child,std::vector<int> sibling, std::vector<int> weight,std::vector<int> upper,std::vector<int> lower) {
-  
   init(root,0);
-  P = std::vector<int>(0,height+1);
-  median=median_table(height);
+  P.assign( height+1, -1);
+  median=medianTable(height);
   visit(root,0);
   return answer;
-} // end tree_path_maxima
+}
+
+const int* MSTVerifier::medianTable( int h)
+{
+  if ( h <= smallHeight)
+    return SmallMedianTable::table;
+
+  CachedTable* cached = largestTable.load( std::memory_order_acquire);
+  if ( cached == NULL || cached->height < h)
+  {
+    std::lock_guard<std::mutex> hold( tableLock);
+    cached = largestTable.load( std::memory_order_acquire);
+    if ( cached == NULL || cached->height < h)
+    {
+      cached = new CachedTable;
+      cached->height = h;
+      cached->median = median_table(h);
+      largestTable.store( cached, std::memory_order_release);
+    }
+  }
+  return cached->median.data();
+}
 
 void MSTVerifier::init(int u,int d) { // d = depth of u
     depth[u]=d;
@@ -46,30 +110,29 @@ void MSTVerifier::init(int u,int d) { // d = depth of u
       D[u]|=D[v]&~(1<<d);
     }
   }
-  
-  
+
+
 // Stores the subsets of size k of {0,...,n-1} in T,
 // starting in position p, and returns p plus their number.
-int MSTVerifier::subsets(int n,int k,int p, std::vector<int> T) {
+int MSTVerifier::subsets(int n,int k,int p, std::vector<int>& T) {
   if (n<k) return p;
   if (k==0) { T[p]=0; return p+1; }
   int q=subsets(n-1,k-1,p,T);
   for (int i=p;i<q;i++) T[i]|=1<<(n-1);
   return subsets(n-1,k,q,T);
   }//end subsets
-  
-// Returns a table of size 2^(h+1) whose entry in position i,
-// i=0,...,2^(h-1)-1, is the median of the set represented by
 
+// Returns a table of size 2^(h+1) whose entry in position i,
+// i=0,...,2^(h+1)-1, is the median of the set represented by i
 std::vector<int> MSTVerifier::median_table(int h) {
-   std::vector<int> T= std::vector<int>((1<<h)+1, -1),median= std::vector<int>(1<<h+1, -1);
+   std::vector<int> T((1<<h)+1, -1),median(1<<(h+1), -1);
     for (int s=0;s<=h;s++) {
       for (int k=0;k<=s;k++) {
 	int p=subsets(h-s,k,0, T);
 	int q=subsets(s,k,p, T);
 	q=subsets(s,k+1,q, T);
 	for (int i=0;i<p;i++) {
-	  int b=(1<<s+1)*T[i]+(1<<s); // fixed high bits
+	  int b=(1<<(s+1))*T[i]+(1<<s); // fixed high bits
 	  for (int j=p;j<q;j++)
 	    median[b+T[j]]=s; // variable low bits
 	}
@@ -77,7 +140,7 @@ std::vector<int> MSTVerifier::median_table(int h) {
     }
   return median;
 } // end median_table
-  
+
 // Returns A "downarrow" B
 int MSTVerifier::down(int A,int B) {
   return B&(~(A|B)^(A+(A|~B)));
@@ -87,11 +150,11 @@ void MSTVerifier::visit(int v,int S) { // S = S of parent
 
   P[depth[v]]=v; // push current node on stack
   int k=binary_search(weight[v],down(D[v],S));
-  S=down(D[v],S&(1<<(k+1)-1)|(1<<depth[v]));
-  
+  S=down(D[v],(S&((1<<(k+1))-1))|(1<<depth[v]));
+
   for (int i=L[v];i>=0;i=Lnext[i])
     answer[i]=P[median[down(1<<depth[upper[i]],S)]];
-  
+
   for (int z=child[v];z>=0;z=sibling[z]) visit(z,S);
 } // end visit
 
@@ -99,11 +162,10 @@ int MSTVerifier::binary_search(int w,int S) {
   // Returns max({j in S | weight[P[j]]>w} union {0})
   if (S==0) return 0;
   int j=median[S];
-  while (S!=1<<j) 
+  while (S!=1<<j)
   { // while |S|>1
     S&=(weight[P[j]]>w)?~((1<<j)-1):(1<<j)-1;
     j=median[S];
   }
   return (weight[P[j]]>w)?j:0;
 }
-    
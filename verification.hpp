@@ -4,30 +4,58 @@
 #ifndef VERIFICATION_CPP
 #define VERIFICATION_CPP
 
+#include <cstddef>
 #include <vector>
 #include "boruvka_tree/BoruvkaTree.hpp"
 
+//Read-only view of an array owned by the caller. The verifier borrows its
+//inputs through these, so they must outlive it.
+template <class T>
+class Span
+{
+  public:
+    Span() : first(NULL), count(0) {}
+    Span( const T* data, size_t size) : first(data), count(size) {}
+    Span( const std::vector<T>& values) : first(values.data()), count(values.size()) {}
+
+    size_t size() const { return count; }
+    const T& operator[]( size_t i) const { return first[i]; }
+
+  private:
+    const T* first;
+    size_t count;
+};
+
 class MSTVerifier{
 
   public:
-    //upper and lower hold the source and destination of edges in original graph
-    MSTVerifier( BoruvkaTree treeIn, std::vector<int> weight, std::vector<int> upper, std::vector<int> lower);
+    //child[u] is the first child of u and sibling[u] the next child of its parent, -1 where there is none,
+    //weight[v] is the weight of the edge from v to its parent, and query i asks for the
+    //heaviest edge on the path from lower[i] up to its ancestor upper[i]
+    MSTVerifier( int root, Span<int> child, Span<int> sibling, Span<int> weight, Span<int> upper, Span<int> lower);
+
+    //answer[i] is the node below the heaviest edge of query i's path
+    std::vector<int> treePathMaxima();
 
-    std::vector<int> treePathMaxima(); 
+    //Table of size 2^(h+1) whose entry i is the median of the set of bits in i.
+    //Built once per height and shared by every verifier; small heights are
+    //generated at compile time.
+    static const int* medianTable( int h);
 
   private:
-    BoruvkaTree tree;
+    int root;
     int height;
     int n;
     int m;
-    std::vector<int> depth, D, L, Lnext, answer, median, P, weight, upper, lower, child, sibling;
+    Span<int> child, sibling, weight, upper, lower;
+    const int* median;
+    std::vector<int> depth, D, L, Lnext, answer, P;
 
     void init( int u, int d);
-    int subsets(int n,int k,int p, std::vector<int> T);
-    std::vector<int> median_table( int h);
+    static int subsets(int n,int k,int p, std::vector<int>& T);
+    static std::vector<int> median_table( int h);
     int down( int A, int B);
     void visit( int v, int S);
     int binary_search( int w, int S);
-    std::vector<int> tree_path_maxima(int root,std::vector<int> child,std::vector<int> sibling, std::vector<int> weight,std::vector<int> upper,std::vector<int> lower);
 };
 #endif
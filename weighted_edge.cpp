@@ -0,0 +1,26 @@
+/*
+ * Ordering helpers for WeightedEdge. Breaking weight ties by id gives every
+ * edge a distinct rank, which keeps the Boruvka steps from closing cycles.
+ */
+
+#include "weighted_edge.hpp"
+
+WeightedEdge findMinWeightEdge( WeightedEdge edge1, WeightedEdge edge2)
+{
+  if ( edge1.weight != edge2.weight) return edge1.weight < edge2.weight ? edge1 : edge2;
+  return edge1.id < edge2.id ? edge1 : edge2;
+}
+
+bool compareByEndpoints( const WeightedEdge& edge1, const WeightedEdge& edge2)
+{
+  if ( edge1.source != edge2.source) return edge1.source < edge2.source;
+  if ( edge1.target != edge2.target) return edge1.target < edge2.target;
+  if ( edge1.weight != edge2.weight) return edge1.weight < edge2.weight;
+  return edge1.id < edge2.id;
+}
+
+bool compareByWeight( const WeightedEdge& edge1, const WeightedEdge& edge2)
+{
+  if ( edge1.weight != edge2.weight) return edge1.weight < edge2.weight;
+  return edge1.id < edge2.id;
+}
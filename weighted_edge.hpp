@@ -0,0 +1,40 @@
+//Weighted edge hpp
+//Edge record shared by the edge list and compressed forms of the KKT algorithm.
+
+#ifndef WEIGHTED_EDGE_H
+#define WEIGHTED_EDGE_H
+
+#include <vector>
+
+#include "large_array.hpp"
+
+//An undirected weighted edge of a (possibly contracted) graph.
+//id names the edge in the caller's graph, so it survives contraction.
+struct WeightedEdge
+{
+  int source;
+  int target;
+  int weight;
+  int id;
+};
+
+//Edge list in allocateLarge storage, for the lists as long as the input
+typedef std::vector< WeightedEdge, LargeAllocator<WeightedEdge> > EdgeList;
+
+/**
+ * @var WeightedEdge - edge1 - The first edge
+ * @var WeightedEdge - edge2 - The second edge
+ * @return WeightedEdge Lower weight edge, ties broken by id so every
+ * supervertex agrees on the same minimum
+ * { -1, -1, INT_MAX, INT_MAX } loses to every real edge, INT_MAX weights
+ * included, so it stands for "no edge yet"; test it by its source of -1.
+ */
+WeightedEdge findMinWeightEdge( WeightedEdge edge1, WeightedEdge edge2);
+
+//Orders edges by endpoints, putting the lightest of any parallel edges first
+bool compareByEndpoints( const WeightedEdge& edge1, const WeightedEdge& edge2);
+
+//Orders edges by weight, ties broken by id
+bool compareByWeight( const WeightedEdge& edge1, const WeightedEdge& edge2);
+
+#endif